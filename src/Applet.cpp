@@ -18,27 +18,119 @@
 ///////////////////////////////////////////////////////////////////////////////
 #include "Applet.h"
 
+#include <string.h>
+
 Applet::Applet(Samba& samba,
                uint32_t addr,
                uint8_t* code,
                uint32_t size,
                uint32_t start,
                uint32_t stack,
-               uint32_t reset) :
-    _samba(samba), _addr(addr), _size(size), _start(start), _stack(stack), _reset(reset)
+               uint32_t reset,
+               uint32_t signature) :
+    _samba(samba), _addr(addr), _size(size), _start(start), _stack(stack), _reset(reset),
+    _image(code, code + size), _loaded(code, code + size)
 {
-    _samba.write(addr, code, size);
+    uint32_t hash = 2166136261U;
+    uint32_t resident;
+
+    // FNV-1a of the code with every parameter at zero so the signature
+    // only changes with the applet itself
+    for (uint32_t i = 0; i < size; i++)
+    {
+        hash ^= code[i];
+        hash *= 16777619;
+    }
+    // Cleared SRAM must never look like a resident applet
+    if (hash == 0)
+        hash = 1;
+    setParam(signature, hash);
+    _loaded = _image;
+
+    // SRAM survives a reset so firmware run since the last session may
+    // have overwritten part of the code while leaving the signature alone.
+    // The whole code and signature are read back in one transfer and the
+    // upload is only skipped when every byte matches.
+    resident = signature - addr + sizeof(uint32_t);
+    std::vector<uint8_t> loaded(resident);
+    _samba.read(addr, &loaded[0], resident);
+
+    if (memcmp(&loaded[0], &_image[0], resident) == 0)
+    {
+        // Only the parameters after the signature are unknown.  Marking
+        // them all stale makes the next flushParams() send them.
+        for (uint32_t i = resident; i < size; i++)
+            _loaded[i] = ~_image[i];
+    }
+    else
+    {
+        _samba.write(addr, &_image[0], size);
+    }
 }
 
 void
 Applet::setStack(uint32_t stack)
 {
-    _samba.writeWord(_stack, stack);
+    setParam(_stack, stack);
+}
+
+void
+Applet::setParam(uint32_t addr, uint32_t value)
+{
+    uint32_t offset = addr - _addr;
+
+    // Parameters are only staged here and sent by flushParams()
+    _image[offset + 0] = value;
+    _image[offset + 1] = value >> 8;
+    _image[offset + 2] = value >> 16;
+    _image[offset + 3] = value >> 24;
+}
+
+void
+Applet::flushParams()
+{
+    uint32_t first;
+    uint32_t last;
+
+    for (first = 0; first < _size; first += sizeof(uint32_t))
+    {
+        if (memcmp(&_image[first], &_loaded[first], sizeof(uint32_t)) != 0)
+            break;
+    }
+    if (first >= _size)
+        return;
+
+    for (last = _size - sizeof(uint32_t); last > first; last -= sizeof(uint32_t))
+    {
+        if (memcmp(&_image[last], &_loaded[last], sizeof(uint32_t)) != 0)
+            break;
+    }
+
+    // The parameters are adjacent at the end of the applet so all the
+    // changed ones go out in one transfer.  XMODEM adds several round
+    // trips per transfer so over a UART only the changed words are sent.
+    if (_samba.isUsb())
+    {
+        _samba.write(_addr + first, &_image[first], last + sizeof(uint32_t) - first);
+    }
+    else
+    {
+        for (uint32_t offset = first; offset <= last; offset += sizeof(uint32_t))
+        {
+            if (memcmp(&_image[offset], &_loaded[offset], sizeof(uint32_t)) != 0)
+                _samba.writeWord(_addr + offset,
+                                 _image[offset] | (_image[offset + 1] << 8) |
+                                 (_image[offset + 2] << 16) | (_image[offset + 3] << 24));
+        }
+    }
+    _loaded = _image;
 }
 
 void
 Applet::run()
 {
+    flushParams();
+
     // Add one to the start address for Thumb mode
     _samba.go(_start + 1);
 }
@@ -47,7 +139,8 @@ void
 Applet::runv()
 {
     // Add one to the start address for Thumb mode
-    _samba.writeWord(_reset, _start + 1);
+    setParam(_reset, _start + 1);
+    flushParams();
 
     // The stack is the first reset vector
     _samba.go(_stack);
@@ -20,6 +20,7 @@
 #define _APPLET_H
 
 #include <stdint.h>
+#include <vector>
 
 #include "Samba.h"
 
@@ -32,7 +33,8 @@ public:
            uint32_t size,
            uint32_t start,
            uint32_t stack,
-           uint32_t reset);
+           uint32_t reset,
+           uint32_t signature);
     virtual ~Applet() {}
 
     virtual uint32_t size() { return _size; }
@@ -44,12 +46,19 @@ public:
     virtual void runv();
 
 protected:
+    void setParam(uint32_t addr, uint32_t value);
+    void flushParams();
+
     Samba& _samba;
     uint32_t _addr;
     uint32_t _size;
     uint32_t _start;
     uint32_t _stack;
     uint32_t _reset;
+
+private:
+    std::vector<uint8_t> _image;
+    std::vector<uint8_t> _loaded;
 };
 
 #endif // _APPLET_H
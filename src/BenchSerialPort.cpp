@@ -0,0 +1,149 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#include "BenchSerialPort.h"
+
+BenchSerialPort::BenchSerialPort(SerialPort::Ptr port, int baud, int latencyUs)
+    : SerialPort(port->name()), _port(port), _baud(baud),
+      _latencyUs(latencyUs), _output(false)
+{
+}
+
+BenchSerialPort::~BenchSerialPort()
+{
+}
+
+void
+BenchSerialPort::reset()
+{
+    _counters = BenchCounters();
+    _output = false;
+}
+
+void
+BenchSerialPort::input(int bytes)
+{
+    _counters.syscalls++;
+
+    // Reading after writing waits for the far end to turn the link around
+    if (_output)
+    {
+        _counters.roundTrips++;
+        _counters.linkUs += _latencyUs;
+        _output = false;
+    }
+
+    if (bytes > 0)
+    {
+        _counters.bytesIn += bytes;
+        if (_baud > 0)
+            _counters.linkUs += bytes * 10 * 1e6 / _baud;
+    }
+}
+
+void
+BenchSerialPort::output(int bytes)
+{
+    _counters.syscalls++;
+    _output = true;
+
+    if (bytes > 0)
+    {
+        _counters.bytesOut += bytes;
+        if (_baud > 0)
+            _counters.linkUs += bytes * 10 * 1e6 / _baud;
+    }
+}
+
+bool
+BenchSerialPort::open(int baud, int data, SerialPort::Parity parity,
+                      SerialPort::StopBit stop)
+{
+    return _port->open(baud, data, parity, stop);
+}
+
+void
+BenchSerialPort::close()
+{
+    _port->close();
+}
+
+bool
+BenchSerialPort::isUsb()
+{
+    return _port->isUsb();
+}
+
+int
+BenchSerialPort::read(uint8_t* data, int size)
+{
+    int bytes = _port->read(data, size);
+
+    input(bytes);
+    return bytes;
+}
+
+int
+BenchSerialPort::write(const uint8_t* data, int size)
+{
+    int bytes = _port->write(data, size);
+
+    output(bytes);
+    return bytes;
+}
+
+int
+BenchSerialPort::writev(const SerialBuffer* buffers, int count)
+{
+    int bytes = _port->writev(buffers, count);
+
+    output(bytes);
+    return bytes;
+}
+
+int
+BenchSerialPort::get()
+{
+    int c = _port->get();
+
+    input(c < 0 ? 0 : 1);
+    return c;
+}
+
+int
+BenchSerialPort::put(int c)
+{
+    int result = _port->put(c);
+
+    output(result < 0 ? 0 : 1);
+    return result;
+}
+
+bool
+BenchSerialPort::timeout(int millisecs)
+{
+    return _port->timeout(millisecs);
+}
+
+void
+BenchSerialPort::flush()
+{
+    _counters.syscalls++;
+    _counters.flushes++;
+    _port->flush();
+}
@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef _BENCHSERIALPORT_H
+#define _BENCHSERIALPORT_H
+
+#include <stdint.h>
+
+#include "SerialPort.h"
+
+// Link traffic counted since the last reset
+class BenchCounters
+{
+public:
+    BenchCounters() : bytesIn(0), bytesOut(0), syscalls(0), roundTrips(0),
+                      flushes(0), linkUs(0) {}
+
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+    uint64_t syscalls;      // Calls that reach the underlying port
+    uint64_t roundTrips;    // Turns of the link from output to input
+    uint64_t flushes;
+    double linkUs;          // Modeled link time
+};
+
+// Passes every call through to another port while counting the traffic.
+// The time the same traffic would take over a link with the given baud
+// rate and turnaround latency is modeled rather than slept so that runs
+// against a fast stand-in stay quick and repeatable.  A baud rate of 0
+// models an unlimited link.
+class BenchSerialPort : public SerialPort
+{
+public:
+    BenchSerialPort(SerialPort::Ptr port, int baud = 0, int latencyUs = 0);
+    virtual ~BenchSerialPort();
+
+    bool open(int baud = 115200,
+              int data = 8,
+              SerialPort::Parity parity = SerialPort::ParityNone,
+              SerialPort::StopBit stop = SerialPort::StopBitOne);
+    void close();
+
+    bool isUsb();
+
+    int read(uint8_t* data, int size);
+    int write(const uint8_t* data, int size);
+    int writev(const SerialBuffer* buffers, int count);
+    int get();
+    int put(int c);
+
+    bool timeout(int millisecs);
+    void flush();
+
+    const BenchCounters& counters() { return _counters; }
+    void reset();
+
+private:
+    SerialPort::Ptr _port;
+    int _baud;
+    int _latencyUs;
+    bool _output;
+    BenchCounters _counters;
+
+    void input(int bytes);
+    void output(int bytes);
+};
+
+#endif // _BENCHSERIALPORT_H
@@ -0,0 +1,59 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#include "BlankCheckApplet.h"
+
+BlankCheckApplet::BlankCheckApplet(Samba& samba, uint32_t addr)
+    : Applet(samba,
+             addr,
+             applet.code,
+             sizeof(applet.code),
+             addr + applet.start,
+             addr + applet.stack,
+             addr + applet.reset,
+             addr + applet.signature)
+{
+}
+
+BlankCheckApplet::~BlankCheckApplet()
+{
+}
+
+void
+BlankCheckApplet::setDstAddr(uint32_t dstAddr)
+{
+    setParam(_addr + applet.dst_addr, dstAddr);
+}
+
+void
+BlankCheckApplet::setSrcAddr(uint32_t srcAddr)
+{
+    setParam(_addr + applet.src_addr, srcAddr);
+}
+
+void
+BlankCheckApplet::setWords(uint32_t words)
+{
+    setParam(_addr + applet.words, words);
+}
+
+void
+BlankCheckApplet::setPages(uint32_t pages)
+{
+    setParam(_addr + applet.pages, pages);
+}
@@ -0,0 +1,43 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef _BLANKCHECKAPPLET_H
+#define _BLANKCHECKAPPLET_H
+
+#include "Applet.h"
+#include "BlankCheckArm.h"
+
+class BlankCheckApplet : public Applet
+{
+public:
+    BlankCheckApplet(Samba& samba, uint32_t addr);
+    virtual ~BlankCheckApplet();
+
+    void setDstAddr(uint32_t dstAddr);
+    void setSrcAddr(uint32_t srcAddr);
+    void setWords(uint32_t words);
+    void setPages(uint32_t pages);
+
+private:
+    // The memory emulator runs its own copy of the blank check
+    friend class MemorySerialPort;
+
+    static BlankCheckArm applet;
+};
+
+#endif // _BLANKCHECKAPPLET_H
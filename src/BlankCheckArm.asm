@@ -0,0 +1,88 @@
+    .global start
+    .global signature
+    .global stack
+    .global reset
+    .global src_addr
+    .global dst_addr
+    .global words
+    .global pages
+
+    .text
+    .thumb
+    .align 0
+
+start:
+    push    {r4, r5, r6, r7}
+    ldr     r0, src_addr
+    ldr     r1, dst_addr
+    ldr     r2, pages
+    mov     r3, #0
+    mov     r4, #1
+    b       check
+
+    @ Scan a page for any word that is not erased
+page:
+    ldr     r5, words
+scan:
+    ldmia   r0!, {r6}
+    add     r6, #1
+    bne     dirty
+    sub     r5, #1
+    bne     scan
+    b       next
+
+    @ Mark the page and skip the rest of it
+dirty:
+    orr     r3, r4
+    sub     r5, #1
+    lsl     r5, r5, #2
+    add     r0, r5
+
+    @ Store the bitmap every 32 pages
+next:
+    lsl     r4, r4, #1
+    bne     more
+    stmia   r1!, {r3}
+    mov     r3, #0
+    mov     r4, #1
+more:
+    sub     r2, #1
+
+check:
+    cmp     r2, #0
+    bne     page
+
+    @ Store any partial bitmap word
+    cmp     r4, #1
+    beq     done
+    stmia   r1!, {r3}
+
+done:
+    pop     {r4, r5, r6, r7}
+
+    @ Fix for SAM-BA stack bug
+    ldr     r0, reset
+    cmp     r0, #0
+    bne     return
+    ldr     r0, stack
+    mov     sp, r0
+
+return:
+    bx      lr
+
+    .align  0
+@ Written by the host to recognize a resident copy of the applet
+signature:
+    .word   0
+stack:
+    .word   0
+reset:
+    .word   0
+src_addr:
+    .word   0
+dst_addr:
+    .word   0
+words:
+    .word   0
+pages:
+    .word   0
@@ -0,0 +1,32 @@
+// WARNING!!! DO NOT EDIT - FILE GENERATED BY APPLETGEN
+#include "BlankCheckArm.h"
+#include "BlankCheckApplet.h"
+
+BlankCheckArm BlankCheckApplet::applet = {
+// dst_addr
+0x00000058,
+// pages
+0x00000060,
+// reset
+0x00000050,
+// signature
+0x00000048,
+// src_addr
+0x00000054,
+// stack
+0x0000004c,
+// start
+0x00000000,
+// words
+0x0000005c,
+// code
+{
+0xf0, 0xb4, 0x14, 0x48, 0x14, 0x49, 0x16, 0x4a, 0x00, 0x23, 0x01, 0x24, 0x10, 0xe0, 0x13, 0x4d,
+0x40, 0xc8, 0x01, 0x36, 0x02, 0xd1, 0x01, 0x3d, 0xfa, 0xd1, 0x03, 0xe0, 0x23, 0x43, 0x01, 0x3d,
+0xad, 0x00, 0x40, 0x19, 0x64, 0x00, 0x02, 0xd1, 0x08, 0xc1, 0x00, 0x23, 0x01, 0x24, 0x01, 0x3a,
+0x00, 0x2a, 0xec, 0xd1, 0x01, 0x2c, 0x00, 0xd0, 0x08, 0xc1, 0xf0, 0xbc, 0x04, 0x48, 0x00, 0x28,
+0x01, 0xd1, 0x02, 0x48, 0x85, 0x46, 0x70, 0x47, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00,
+}
+};
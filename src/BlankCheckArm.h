@@ -0,0 +1,20 @@
+// WARNING!!! DO NOT EDIT - FILE GENERATED BY APPLETGEN
+#ifndef _BLANKCHECKARM_H
+#define _BLANKCHECKARM_H
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint32_t dst_addr;
+    uint32_t pages;
+    uint32_t reset;
+    uint32_t signature;
+    uint32_t src_addr;
+    uint32_t stack;
+    uint32_t start;
+    uint32_t words;
+    uint8_t code[100];
+} BlankCheckArm;
+
+#endif // _BLANKCHECKARM_H
@@ -0,0 +1,39 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef _BLOCKCOPYAPPLET_H
+#define _BLOCKCOPYAPPLET_H
+
+#include "CopyApplet.h"
+#include "BlockCopyArm.h"
+
+class BlockCopyApplet : public CopyApplet
+{
+public:
+    BlockCopyApplet(Samba& samba, uint32_t addr);
+    virtual ~BlockCopyApplet();
+
+    void setDstAddr(uint32_t dstAddr);
+    void setSrcAddr(uint32_t srcAddr);
+    void setWords(uint32_t words);
+
+private:
+    static BlockCopyArm applet;
+};
+
+#endif // _BLOCKCOPYAPPLET_H
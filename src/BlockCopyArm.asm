@@ -0,0 +1,67 @@
+    .global start
+    .global signature
+    .global stack
+    .global reset
+    .global dst_addr
+    .global src_addr
+    .global words
+
+    .syntax unified
+    .cpu cortex-m3
+    .text
+    .thumb
+    .align 2
+
+start:
+    push    {r4-r10}
+    ldr     r0, dst_addr
+    ldr     r1, src_addr
+    ldr     r2, words
+    b       check8
+
+    @ Copy eight words per iteration
+copy8:
+    ldmia   r1!, {r3-r10}
+    stmia   r0!, {r3-r10}
+
+check8:
+    subs    r2, r2, #8
+    bhs     copy8
+    adds    r2, r2, #8
+    b       check1
+
+    @ Copy the remaining words
+copy1:
+    ldr     r3, [r1], #4
+    str     r3, [r0], #4
+
+check1:
+    subs    r2, r2, #1
+    bhs     copy1
+
+    pop     {r4-r10}
+
+    @ Fix for SAM-BA stack bug
+    ldr     r0, reset
+    cmp     r0, #0
+    bne     return
+    ldr     r0, stack
+    mov     sp, r0
+
+return:
+    bx      lr
+
+    .align  2
+@ Written by the host to recognize a resident copy of the applet
+signature:
+    .word   0
+stack:
+    .word   0
+reset:
+    .word   0
+dst_addr:
+    .word   0
+src_addr:
+    .word   0
+words:
+    .word   0
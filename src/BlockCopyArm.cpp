@@ -0,0 +1,28 @@
+// WARNING!!! DO NOT EDIT - FILE GENERATED BY APPLETGEN
+#include "BlockCopyArm.h"
+#include "BlockCopyApplet.h"
+
+BlockCopyArm BlockCopyApplet::applet = {
+// dst_addr
+0x00000044,
+// reset
+0x00000040,
+// signature
+0x00000038,
+// src_addr
+0x00000048,
+// stack
+0x0000003c,
+// start
+0x00000000,
+// words
+0x0000004c,
+// code
+{
+0x2d, 0xe9, 0xf0, 0x07, 0x0f, 0x48, 0x10, 0x49, 0x10, 0x4a, 0x03, 0xe0, 0xb1, 0xe8, 0xf8, 0x07,
+0xa0, 0xe8, 0xf8, 0x07, 0x08, 0x3a, 0xf9, 0xd2, 0x08, 0x32, 0x03, 0xe0, 0x51, 0xf8, 0x04, 0x3b,
+0x40, 0xf8, 0x04, 0x3b, 0x52, 0x1e, 0xf9, 0xd2, 0xbd, 0xe8, 0xf0, 0x07, 0x04, 0x48, 0x00, 0x28,
+0x01, 0xd1, 0x02, 0x48, 0x85, 0x46, 0x70, 0x47, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+}
+};
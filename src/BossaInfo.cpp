@@ -57,6 +57,9 @@ BossaInfo::BossaInfo(wxWindow* parent) : InfoDialog(parent)
         _lockCheckBox28, _lockCheckBox29, _lockCheckBox30, _lockCheckBox31,
     };
 
+    std::vector<bool> regions;
+    flash->getLockRegions(regions);
+
     for (uint32_t i = 0; i < sizeof(lockCheckBox) / sizeof(lockCheckBox[0]); i++)
     {
         if (i >= lockRegions)
@@ -66,7 +69,7 @@ BossaInfo::BossaInfo(wxWindow* parent) : InfoDialog(parent)
         else
         {
             lockCheckBox[i]->Enable(false);
-            lockCheckBox[i]->SetValue(flash->getLockRegion(i));
+            lockCheckBox[i]->SetValue(regions[i]);
         }
     }
 
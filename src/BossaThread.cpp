@@ -30,29 +30,18 @@ DEFINE_EVENT_TYPE(wxEVT_THREAD_SUCCESS)
 DEFINE_EVENT_TYPE(wxEVT_THREAD_WARNING)
 DEFINE_EVENT_TYPE(wxEVT_THREAD_ERROR)
 
-class FileOpenError : public exception
+BossaThread::BossaThread(wxEvtHandler* parent, const wxString& operation) :
+    wxThread(), _parent(parent), _operation(operation), _stopped(false)
 {
-public:
-    FileOpenError() : exception() {};
-    const char* what() const throw() { return "Unable to open file"; }
-};
-
-class FileIoError : public exception
-{
-public:
-    FileIoError() : exception() {};
-    const char* what() const throw() { return "File I/O operation failed"; }
-};
+}
 
-class FileSizeError : public exception
+void
+BossaThread::onProgress(int num, int div)
 {
-public:
-    FileSizeError() : exception() {};
-    const char* what() const throw() { return "File operation exceeds flash size"; }
-};
+    int percent = div ? num * 100 / div : 100;
 
-BossaThread::BossaThread(wxEvtHandler* parent) : wxThread(), _parent(parent), _stopped(false)
-{
+    Progress(wxString::Format(wxT("%s page %d (%d%%)"), _operation.c_str(), num, percent),
+             percent);
 }
 
 void
@@ -96,7 +85,7 @@ WriteThread::WriteThread(wxEvtHandler* parent,
                          bool bor,
                          bool lock,
                          bool security) :
-    BossaThread(parent), _filename(filename), _eraseAll(eraseAll),
+    BossaThread(parent, _("Writing")), _filename(filename), _eraseAll(eraseAll),
     _bootFlash(bootFlash), _bod(bod), _bor(bor), _lock(lock), _security(security)
 
 {
@@ -105,67 +94,15 @@ WriteThread::WriteThread(wxEvtHandler* parent,
 wxThread::ExitCode
 WriteThread::Entry()
 {
-    FILE* infile = NULL;
     Flash& flash = *wxGetApp().flash;
-    uint32_t pageSize = flash.pageSize();
-    uint8_t buffer[pageSize];
-    uint32_t pageNum = 0;
-    uint32_t numPages;
-    long fsize;
-    size_t fbytes;
+    Flasher flasher(wxGetApp().flash, *this);
 
     try
     {
         if (_eraseAll)
-        {
-            flash.eraseAll();
-            flash.eraseAuto(false);
-        }
-        else
-        {
-            flash.eraseAuto(true);
-        }
-
-        infile = fopen(_filename.mb_str(), "rb");
-        if (!infile)
-            throw FileOpenError();
-
-        if (fseek(infile, 0, SEEK_END) != 0 ||
-            (fsize = ftell(infile)) < 0)
-            throw FileIoError();
-        rewind(infile);
-
-        numPages = (fsize + pageSize - 1) / pageSize;
-        if (numPages > flash.numPages())
-            throw FileSizeError();
+            flasher.erase();
 
-        while ((fbytes = fread(buffer, 1, pageSize, infile)) > 0)
-        {
-            if (_stopped)
-            {
-                fclose(infile);
-                Warning(wxT("Write stopped"));
-                return 0;
-            }
-
-            if (pageNum % 10 == 0 || pageNum == numPages - 1)
-            {
-                uint32_t percent = (pageNum + 1) * 100 / numPages;
-                Progress(wxString::Format(wxT("Writing page %d (%d%%)"), pageNum, percent),
-                         percent);
-            }
-
-            flash.loadBuffer(buffer);
-            flash.writePage(pageNum);
-
-            pageNum++;
-            if (pageNum == numPages)
-                break;
-            if (fbytes != pageSize)
-                throw FileIoError();
-        }
-        if (fbytes <= 0)
-            throw FileIoError();
+        flasher.write(_filename.mb_str(), 0);
 
         flash.setBootFlash(_bootFlash);
         flash.setBod(_bod);
@@ -174,13 +111,14 @@ WriteThread::Entry()
             flash.lockAll();
         if (_security)
             flash.setSecurity();
-
-        fclose(infile);
+    }
+    catch(FlasherCancelError& e)
+    {
+        Warning(_("Write stopped"));
+        return 0;
     }
     catch(exception& e)
     {
-        if (infile)
-            fclose(infile);
         Error(wxString(e.what(), wxConvUTF8));
         return 0;
     }
@@ -190,97 +128,37 @@ WriteThread::Entry()
 }
 
 VerifyThread::VerifyThread(wxEvtHandler* parent, const wxString& filename) :
-    BossaThread(parent), _filename(filename)
+    BossaThread(parent, _("Verifying")), _filename(filename)
 {
 }
 
 wxThread::ExitCode
 VerifyThread::Entry()
 {
-    FILE* infile = NULL;
-    Flash& flash = *wxGetApp().flash;
-    uint32_t pageSize = flash.pageSize();
-    uint8_t bufferA[pageSize];
-    uint8_t bufferB[pageSize];
-    uint32_t pageNum = 0;
-    uint32_t numPages;
-    uint32_t byteErrors = 0;
-    uint32_t pageErrors = 0;
-    uint32_t totalErrors = 0;
-    long fsize;
-    size_t fbytes;
+    Flasher flasher(wxGetApp().flash, *this);
+    uint32_t pageErrors;
+    uint32_t totalErrors;
 
     try
     {
-        infile = fopen(_filename.mb_str(), "rb");
-        if (!infile)
-            throw FileOpenError();
-
-        if (fseek(infile, 0, SEEK_END) != 0 ||
-            (fsize = ftell(infile)) < 0)
-            throw FileIoError();
-        rewind(infile);
-
-        numPages = (fsize + pageSize - 1) / pageSize;
-        if (numPages > flash.numPages())
-            throw FileSizeError();
-
-        while ((fbytes = fread(bufferA, 1, pageSize, infile)) > 0)
+        if (!flasher.verify(_filename.mb_str(), 0, pageErrors, totalErrors))
         {
-            if (_stopped)
-            {
-                fclose(infile);
-                Warning(wxT("Verify stopped"));
-                return 0;
-            }
-
-            if (pageNum % 10 == 0 || pageNum == numPages - 1)
-            {
-                uint32_t percent = (pageNum + 1) * 100 / numPages;
-                Progress(wxString::Format(wxT("Verifying page %d (%d%%)"), pageNum, percent),
-                         percent);
-            }
-
-            flash.readPage(pageNum, bufferB);
-
-            byteErrors = 0;
-            for (uint32_t i = 0; i < fbytes; i++)
-            {
-                if (bufferA[i] != bufferB[i])
-                    byteErrors++;
-            }
-            if (byteErrors != 0)
-            {
-                pageErrors++;
-                totalErrors += byteErrors;
-            }
-
-            pageNum++;
-            if (pageNum == numPages)
-                break;
-            if (fbytes != pageSize)
-                throw FileIoError();
+            Warning(wxString::Format(_(
+                "Verify failed\n"
+                "Page errors: %d\n"
+                "Byte errors: %d\n"),
+                pageErrors, totalErrors));
+            return 0;
         }
-        if (fbytes <= 0)
-            throw FileIoError();
-
-        fclose(infile);
     }
-    catch(exception& e)
+    catch(FlasherCancelError& e)
     {
-        if (infile)
-            fclose(infile);
-        Error(wxString(e.what(), wxConvUTF8));
+        Warning(_("Verify stopped"));
         return 0;
     }
-
-    if (byteErrors != 0)
+    catch(exception& e)
     {
-        Warning(wxString::Format(_(
-            "Verify failed\n"
-            "Page errors: %d\n"
-            "Byte errors: %d\n"),
-            pageErrors, totalErrors));
+        Error(wxString(e.what(), wxConvUTF8));
         return 0;
     }
 
@@ -290,62 +168,26 @@ VerifyThread::Entry()
 }
 
 ReadThread::ReadThread(wxEvtHandler* parent, const wxString& filename, size_t size) :
-    BossaThread(parent), _filename(filename), _size(size)
+    BossaThread(parent, _("Reading")), _filename(filename), _size(size)
 {
 }
 
 wxThread::ExitCode
 ReadThread::Entry()
 {
-    FILE* outfile = NULL;
-    Flash& flash = *wxGetApp().flash;
-    uint32_t pageSize = flash.pageSize();
-    uint8_t buffer[pageSize];
-    uint32_t pageNum = 0;
-    uint32_t numPages;
-
-    if (_size == 0)
-        _size = pageSize * flash.numPages();
-
-    outfile = fopen(_filename.mb_str(), "wb");
-    if (!outfile)
-        throw FileOpenError();
+    Flasher flasher(wxGetApp().flash, *this);
 
     try
     {
-        numPages = (_size + pageSize - 1) / pageSize;
-        if (numPages > flash.numPages())
-            throw FileSizeError();
-
-        for (pageNum = 0; pageNum < numPages; pageNum++)
-        {
-            if (_stopped)
-            {
-                fclose(outfile);
-                Warning(wxT("Read stopped"));
-                return 0;
-            }
-
-            if (pageNum % 10 == 0 || pageNum == numPages - 1)
-            {
-                uint32_t percent = (pageNum + 1) * 100 / numPages;
-                Progress(wxString::Format(wxT("Reading page %d (%d%%)"), pageNum, percent),
-                         percent);
-            }
-
-            flash.readPage(pageNum, buffer);
-
-            if (pageNum == numPages - 1 && _size % pageSize > 0)
-                pageSize = _size % pageSize;
-            if (fwrite(buffer, 1, pageSize, outfile) != pageSize)
-                throw FileIoError();
-        }
-        fclose(outfile);
+        flasher.read(_filename.mb_str(), 0, _size);
+    }
+    catch(FlasherCancelError& e)
+    {
+        Warning(_("Read stopped"));
+        return 0;
     }
     catch(exception& e)
     {
-        if (outfile)
-            fclose(outfile);
         Error(wxString(e.what(), wxConvUTF8));
         return 0;
     }
@@ -353,4 +195,3 @@ ReadThread::Entry()
     Success(_("Read completed successfully"));
     return 0;
 }
-
@@ -21,22 +21,29 @@
 
 #include <wx/wx.h>
 
+#include "Flasher.h"
+
 DECLARE_EVENT_TYPE(wxEVT_THREAD_PROGRESS, wxID_ANY)
 DECLARE_EVENT_TYPE(wxEVT_THREAD_SUCCESS, wxID_ANY)
 DECLARE_EVENT_TYPE(wxEVT_THREAD_WARNING, wxID_ANY)
 DECLARE_EVENT_TYPE(wxEVT_THREAD_ERROR, wxID_ANY)
 
-class BossaThread : public wxThread
+class BossaThread : public wxThread, public FlasherObserver
 {
 public:
-    BossaThread(wxEvtHandler* parent);
+    BossaThread(wxEvtHandler* parent, const wxString& operation);
 
     void stop() { _stopped = true; }
 
+    virtual void onStatus(const char* message, ...) {}
+    virtual void onProgress(int num, int div);
+    virtual bool isCancelled() { return _stopped; }
+
 protected:
     wxEvtHandler* _parent;
+    wxString _operation;
 
-    bool _stopped;
+    volatile bool _stopped;
 
     void Progress(const wxString& message, int pos);
     void Success(const wxString& message);
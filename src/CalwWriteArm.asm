@@ -0,0 +1,126 @@
+    .global start
+    .global signature
+    .global stack
+    .global reset
+    .global dst_addr
+    .global src_addr
+    .global words
+    .global regs
+    .global page
+    .global pages
+    .global erase_cmd
+    .global write_cmd
+    .global status
+
+    .text
+    .thumb
+    .align 0
+
+start:
+    push    {r4, r5, r6, r7, lr}
+    ldr     r3, regs
+    ldr     r2, dst_addr
+    ldr     r1, src_addr
+    ldr     r4, page
+    ldr     r5, pages
+    adr     r7, status
+    mov     r0, #0
+    str     r0, [r7]
+    bl      wait
+    b       check
+
+program:
+    @ Erase the page if requested
+    ldr     r0, erase_cmd
+    cmp     r0, #0
+    beq     clear
+    bl      command
+
+clear:
+    @ Clear the page buffer
+    mov     r0, #3
+    bl      command
+
+    @ Fill the page buffer
+    ldr     r6, words
+copy:
+    ldmia   r1!, {r0}
+    stmia   r2!, {r0}
+    sub     r6, #1
+    bne     copy
+
+    @ Write the page
+    ldr     r0, write_cmd
+    bl      command
+
+    add     r4, #1
+    sub     r5, #1
+
+check:
+    cmp     r5, #0
+    bne     program
+
+done:
+    pop     {r4, r5, r6, r7}
+    pop     {r0}
+    mov     lr, r0
+
+    @ Fix for SAM-BA stack bug
+    ldr     r0, reset
+    cmp     r0, #0
+    bne     return
+    ldr     r0, stack
+    mov     sp, r0
+
+return:
+    bx      lr
+
+    @ Issue the command in r0 for the current page
+command:
+    lsl     r6, r4, #8
+    orr     r0, r6
+    mov     r6, #0xa5
+    lsl     r6, r6, #24
+    orr     r0, r6
+    str     r0, [r3, #4]
+
+    @ Wait for FRDY, recording FSR and aborting on LOCKE or PROGE
+wait:
+    ldr     r6, [r3, #8]
+    mov     r0, #0x0c
+    tst     r0, r6
+    bne     error
+    lsl     r0, r6, #31
+    beq     wait
+    bx      lr
+
+error:
+    str     r6, [r7]
+    b       done
+
+    .align  0
+@ Written by the host to recognize a resident copy of the applet
+signature:
+    .word   0
+stack:
+    .word   0
+reset:
+    .word   0
+dst_addr:
+    .word   0
+src_addr:
+    .word   0
+words:
+    .word   0
+regs:
+    .word   0
+page:
+    .word   0
+pages:
+    .word   0
+erase_cmd:
+    .word   0
+write_cmd:
+    .word   0
+status:
+    .word   0
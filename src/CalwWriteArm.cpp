@@ -0,0 +1,43 @@
+// WARNING!!! DO NOT EDIT - FILE GENERATED BY APPLETGEN
+#include "CalwWriteArm.h"
+#include "CalwWriteApplet.h"
+
+CalwWriteArm CalwWriteApplet::applet = {
+// dst_addr
+0x0000007c,
+// erase_cmd
+0x00000094,
+// page
+0x0000008c,
+// pages
+0x00000090,
+// regs
+0x00000088,
+// reset
+0x00000078,
+// signature
+0x00000070,
+// src_addr
+0x00000080,
+// stack
+0x00000074,
+// start
+0x00000000,
+// status
+0x0000009c,
+// words
+0x00000084,
+// write_cmd
+0x00000098,
+// code
+{
+0xf0, 0xb5, 0x21, 0x4b, 0x1d, 0x4a, 0x1e, 0x49, 0x20, 0x4c, 0x21, 0x4d, 0x23, 0xa7, 0x00, 0x20,
+0x38, 0x60, 0x00, 0xf0, 0x24, 0xf8, 0x11, 0xe0, 0x1e, 0x48, 0x00, 0x28, 0x01, 0xd0, 0x00, 0xf0,
+0x18, 0xf8, 0x03, 0x20, 0x00, 0xf0, 0x15, 0xf8, 0x16, 0x4e, 0x01, 0xc9, 0x01, 0xc2, 0x01, 0x3e,
+0xfb, 0xd1, 0x19, 0x48, 0x00, 0xf0, 0x0d, 0xf8, 0x01, 0x34, 0x01, 0x3d, 0x00, 0x2d, 0xeb, 0xd1,
+0xf0, 0xbc, 0x01, 0xbc, 0x86, 0x46, 0x0c, 0x48, 0x00, 0x28, 0x01, 0xd1, 0x09, 0x48, 0x85, 0x46,
+0x70, 0x47, 0x26, 0x02, 0x30, 0x43, 0xa5, 0x26, 0x36, 0x06, 0x30, 0x43, 0x58, 0x60, 0x9e, 0x68,
+0x0c, 0x20, 0x30, 0x42, 0x02, 0xd1, 0xf0, 0x07, 0xf9, 0xd0, 0x70, 0x47, 0x3e, 0x60, 0xe7, 0xe7,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+}
+};
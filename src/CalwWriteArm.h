@@ -0,0 +1,25 @@
+// WARNING!!! DO NOT EDIT - FILE GENERATED BY APPLETGEN
+#ifndef _CALWWRITEARM_H
+#define _CALWWRITEARM_H
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint32_t dst_addr;
+    uint32_t erase_cmd;
+    uint32_t page;
+    uint32_t pages;
+    uint32_t regs;
+    uint32_t reset;
+    uint32_t signature;
+    uint32_t src_addr;
+    uint32_t stack;
+    uint32_t start;
+    uint32_t status;
+    uint32_t words;
+    uint32_t write_cmd;
+    uint8_t code[160];
+} CalwWriteArm;
+
+#endif // _CALWWRITEARM_H
@@ -23,10 +23,13 @@
 #include <errno.h>
 #include <string.h>
 #include <assert.h>
+#include <sys/time.h>
+#include <new>
 #include <readline/readline.h>
 #include <readline/history.h>
 
 #include "Command.h"
+#include "MemorySerialPort.h"
 #include "arm-dis.h"
 
 #define min(a, b)   ((a) < (b) ? (a) : (b))
@@ -38,7 +41,9 @@ Samba Command::_samba;
 PortFactory Command::_portFactory;
 FlashFactory Command::_flashFactory;
 Flash::Ptr Command::_flash;
-Flasher Command::_flasher(_flash);
+FlasherConsole Command::_console;
+Flasher Command::_flasher(_flash, _console);
+MemoryCache Command::_cache(_samba);
 bool Command::_connected = false;
 
 Command::Command(const char* name, const char* help, const char* usage) :
@@ -56,6 +61,20 @@ Command::error(const char* fmt, ...)
     vprintf(fmt, ap);
     va_end(ap);
     printf(".  Try \"help %s\".\n", _name);
+    _shell->errorFlag() = true;
+
+    return false;
+}
+
+bool
+Command::fail(const char* fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    _shell->errorFlag() = true;
 
     return false;
 }
@@ -130,7 +149,7 @@ Command::connected()
 {
     if (!_connected)
     {
-        printf("No device connected.  Use \"connect\" or \"scan\" first.\n");
+        fail("No device connected.  Use \"connect\" or \"scan\" first.\n");
         return false;
     }
     return true;
@@ -144,7 +163,7 @@ Command::flashable()
 
     if (_flash.get() == NULL)
     {
-        printf("Flash on device is not supported.\n");
+        fail("Flash on device is not supported.\n");
         return false;
     }
     return true;
@@ -155,13 +174,18 @@ Command::createFlash()
 {
     uint32_t chipId = _samba.chipId();
 
+    _cache.clearRanges();
+
     _flash = _flashFactory.create(_samba, chipId);
     if (_flash.get() == NULL)
     {
-        printf("Flash for chip ID %08x is not supported\n", chipId);
+        fail("Flash for chip ID %08x is not supported\n", chipId);
         return false;
     }
 
+    // Flash only changes through commands that invalidate the cache
+    _cache.addRange(_flash->address(), _flash->numPages() * _flash->pageSize());
+
     return true;
 }
 
@@ -224,10 +248,105 @@ Command::binstr(uint32_t value, int bits, char low, char high)
     return buf;
 }
 
+void
+Command::readWords(uint32_t addr, uint32_t* values, uint32_t count)
+{
+    uint32_t words;
+    uint32_t size;
+    uint8_t* buf;
+
+    if (_cache.cacheable(addr, count * sizeof(uint32_t)))
+    {
+        buf = (uint8_t*) values;
+        _cache.read(addr, buf, count * sizeof(uint32_t));
+        for (uint32_t i = 0; i < count; i++, buf += sizeof(uint32_t))
+            values[i] = buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24);
+        return;
+    }
+
+    // A single word is cheaper with the word read command
+    if (count == 1)
+    {
+        *values = _samba.readWord(addr);
+        return;
+    }
+
+    while (count > 0)
+    {
+        words = min(count, chunkSize() / sizeof(uint32_t));
+        size = words * sizeof(uint32_t);
+
+        // Samba::read() gets around the power of two bug with a byte read
+        // that does not work on every peripheral register, so such a
+        // block is read as one word and a block that is not a power of two
+        if ((_samba.quirks() & ChipInfo::QUIRK_READ_POW2) &&
+            size > 32 && !(size & (size - 1)))
+        {
+            *values++ = _samba.readWord(addr);
+            addr += sizeof(uint32_t);
+            count--;
+            words--;
+            size -= sizeof(uint32_t);
+        }
+
+        buf = (uint8_t*) values;
+        _samba.read(addr, buf, size);
+
+        // The device is little endian so convert in place for the host
+        for (uint32_t i = 0; i < words; i++, buf += sizeof(uint32_t))
+            values[i] = buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24);
+
+        values += words;
+        addr += size;
+        count -= words;
+    }
+}
+
+uint32_t
+Command::chunkSize()
+{
+    uint32_t pageSize;
+    uint32_t chunk;
+
+    if (_flash.get() == NULL)
+        return _samba.isUsb() ? 64 * 1024 : 8 * 1024;
+
+    // Chunks are whole pages and no larger than the page buffer ring the
+    // device was sized for, which is the most it moves in one transfer
+    // itself.  XMODEM acknowledges every block so smaller chunks cost
+    // nothing extra there and keep the progress line moving.
+    pageSize = _flash->pageSize();
+    chunk = pageSize * _flash->bufferPages();
+    if (!_samba.isUsb() && chunk > 8 * 1024)
+        chunk = 8 * 1024 / pageSize * pageSize;
+
+    return chunk > pageSize ? chunk : pageSize;
+}
+
+void
+Command::progress(uint32_t done, uint32_t total, const struct timeval& start)
+{
+    struct timeval now;
+    double secs;
+
+    gettimeofday(&now, NULL);
+    secs = (now.tv_sec - start.tv_sec) + (now.tv_usec - start.tv_usec) / 1000000.0;
+
+    printf("\r%u/%u bytes (%u%%)", done, total,
+           total ? (uint32_t) ((uint64_t) done * 100 / total) : 100);
+    if (secs > 0)
+        printf(" %.1f KB/s", done / secs / 1024);
+    printf("   ");
+    if (done == total)
+        printf("\n");
+    fflush(stdout);
+}
+
 void
 Command::disconnect()
 {
     _connected = false;
+    _cache.clearRanges();
 }
 
 bool
@@ -255,7 +374,7 @@ CommandBod::invoke(char* argv[], int argc)
 
     if (!_flash->canBod())
     {
-        printf("Unsupported on this flash device\n");
+        fail("Unsupported on this flash device\n");
         return;
     }
 
@@ -303,7 +422,7 @@ CommandBor::invoke(char* argv[], int argc)
 
     if (!_flash->canBor())
     {
-        printf("Unsupported on this flash device\n");
+        fail("Unsupported on this flash device\n");
         return;
     }
 
@@ -311,6 +430,60 @@ CommandBor::invoke(char* argv[], int argc)
     printf("BOR flag set to %s\n", value ? "true" : "false");
 }
 
+CommandCache::CommandCache() :
+    Command("cache",
+            "Control the memory read cache.",
+            "cache [on|off|flush]\n"
+            "cache add [ADDRESS] [COUNT]\n"
+            "  Flash is cached until it is written, erased or code is executed.\n"
+            "  Other memory is read directly unless added as a cached range.\n"
+            "  The device table does not describe ROM, so add its range to\n"
+            "  cache it.\n"
+            "  ADDRESS -- starting memory address of range to cache\n"
+            "  COUNT -- count of bytes in range")
+{}
+
+void
+CommandCache::invoke(char* argv[], int argc)
+{
+    uint32_t addr;
+    uint32_t count;
+    size_t len;
+
+    if (!argRange(argc, 1, 4))
+        return;
+
+    if (argc == 1)
+    {
+        _cache.info();
+        return;
+    }
+
+    len = strlen(argv[1]);
+    if (strncasecmp(argv[1], "add", len) == 0)
+    {
+        if (!argNum(argc, 4) ||
+            !argUint32(argv[2], &addr) ||
+            !argUint32(argv[3], &count))
+            return;
+
+        _cache.addRange(addr, count);
+        return;
+    }
+
+    if (!argNum(argc, 2))
+        return;
+
+    if (strncasecmp(argv[1], "flush", len) == 0)
+        _cache.flush();
+    else if (strncasecmp(argv[1], "on", len) == 0)
+        _cache.setEnabled(true);
+    else if (strncasecmp(argv[1], "off", len) == 0)
+        _cache.setEnabled(false);
+    else
+        error("Invalid cache operation");
+}
+
 CommandConnect::CommandConnect() :
     Command("connect",
             "Connect to device over serial port.",
@@ -326,7 +499,7 @@ CommandConnect::invoke(char* argv[], int argc)
 
     if (!_samba.connect(_portFactory.create(argv[1])))
     {
-        printf("No device found on %s\n", argv[1]);
+        fail("No device found on %s\n", argv[1]);
         _connected = false;
         return;
     }
@@ -358,9 +531,10 @@ CommandDebug::invoke(char* argv[], int argc)
 CommandDisass::CommandDisass() :
     Command("disass",
             "Disassemble ARM code at memory address.",
-            "disass [ADDRESS] [COUNT]\n"
+            "disass [ADDRESS] [COUNT] <FILE>\n"
             "  ADDRESS -- starting memory address, thumb mode if not word aligned\n"
-            "  COUNT -- count of bytes to disassemble")
+            "  COUNT -- count of bytes to disassemble\n"
+            "  FILE -- (optional) file to write the disassembly to")
 {}
 
 void
@@ -368,33 +542,75 @@ CommandDisass::invoke(char* argv[], int argc)
 {
     uint32_t addr;
     uint32_t count;
+    uint32_t chunk;
+    uint32_t bytes;
+    uint32_t carry = 0;
+    uint32_t done = 0;
+    uint32_t pc;
+    int thumb;
+    FILE* outfile = stdout;
     uint8_t* buf;
+    struct timeval start;
 
-    if (!argNum(argc, 3) ||
+    if (!argRange(argc, 3, 4) ||
         !argUint32(argv[1], &addr) ||
         !argUint32(argv[2], &count) ||
         !connected())
         return;
 
-    buf = (uint8_t*) malloc(count);
+    thumb = addr & 0x3;
+    addr &= ~0x1;
+
+    // Large ranges are read and disassembled a chunk at a time with the
+    // bytes of a split instruction carried over to the next chunk
+    chunk = chunkSize();
+    buf = (uint8_t*) malloc(chunk + sizeof(uint32_t));
     if (!buf)
-        return;
+        throw bad_alloc();
 
-    for (uint32_t i = 0; i < count; i++)
-        buf[i] = i;
+    if (argc == 4)
+    {
+        outfile = fopen(argv[3], "w");
+        if (!outfile)
+        {
+            free(buf);
+            throw FileOpenError(errno);
+        }
+        setvbuf(outfile, NULL, _IOFBF, chunk);
+    }
 
     try
     {
-        _samba.read(addr & ~0x1, buf, count);
+        gettimeofday(&start, NULL);
+        while (done < count)
+        {
+            bytes = min(count - done, chunk);
+            _cache.read(addr + done, buf + carry, bytes);
+            pc = addr + done - carry;
+            done += bytes;
+
+            bytes += carry;
+            carry = arm_dis_buf(buf, bytes, pc, thumb, 1, outfile);
+            memmove(buf, buf + bytes - carry, carry);
+            if (outfile != stdout)
+                progress(done, count, start);
+        }
     }
     catch (...)
     {
         free(buf);
+        if (outfile != stdout)
+            fclose(outfile);
         throw;
     }
 
-    arm_dis_buf(buf, count, addr & ~0x1, addr & 0x3, 1);
     free(buf);
+    if (outfile != stdout)
+    {
+        if (fclose(outfile) != 0)
+            throw FileIoError(errno);
+        printf("Disassembled %u bytes from address %08x\n", count, addr);
+    }
 }
 
 CommandDump::CommandDump() :
@@ -424,7 +640,7 @@ CommandDump::invoke(char* argv[], int argc)
 
     try
     {
-        _samba.read(addr, buf, count);
+        _cache.read(addr, buf, count);
     }
     catch (...)
     {
@@ -449,6 +665,7 @@ CommandErase::invoke(char* argv[], int argc)
         !flashable())
         return;
 
+    _cache.flush();
     _flasher.erase();
     printf("Flash is erased\n");
 }
@@ -486,6 +703,7 @@ CommandGo::invoke(char* argv[], int argc)
         return;
 
     printf("Executing code at %#x\n", addr);
+    _cache.flush();
     _samba.go(addr);
 }
 
@@ -529,6 +747,50 @@ printf("history_base=%d\n", history_base);
     }
 }
 
+CommandImage::CommandImage() :
+    Command("image",
+            "Open an image file as a virtual device.",
+            "image [FILE] [CHIPID]\n"
+            "  FILE -- raw binary loaded at the flash base or ELF loaded at its\n"
+            "          segment addresses\n"
+            "  CHIPID -- chip ID of the device to emulate")
+{}
+
+void
+CommandImage::invoke(char* argv[], int argc)
+{
+    uint32_t chipId;
+    const Device* dev;
+    MemorySerialPort* port;
+
+    if (!argNum(argc, 3) ||
+        !argUint32(argv[2], &chipId))
+        return;
+
+    dev = _flashFactory.device(chipId);
+    if (!dev)
+    {
+        fail("Chip ID %08x is not supported\n", chipId);
+        return;
+    }
+
+    port = new MemorySerialPort(argv[1]);
+    SerialPort::Ptr ptr(port);
+    port->mapDevice(*dev);
+    port->load(argv[1], dev->addr);
+
+    _connected = false;
+    if (!_samba.connect(ptr))
+    {
+        fail("Virtual device failed to connect\n");
+        return;
+    }
+
+    printf("Opened %s as a virtual %s\n", argv[1], dev->name.c_str());
+    _connected = true;
+    createFlash();
+}
+
 CommandInfo::CommandInfo() :
     Command("info",
             "Display information about the flash.",
@@ -581,7 +843,9 @@ CommandMrb::invoke(char* argv[], int argc)
 {
     uint32_t addr;
     uint32_t count = 1;
+    uint32_t chunk;
     uint8_t value;
+    uint8_t* buf;
 
     if (!argRange(argc, 2, 3) ||
         !argUint32(argv[1], &addr) ||
@@ -589,13 +853,34 @@ CommandMrb::invoke(char* argv[], int argc)
         !connected())
         return;
 
-    while (count > 0)
+    if (count == 1)
     {
         value = _samba.readByte(addr);
         printf("%08x : %02x  %s\n", addr, value, binstr(value, 8));
-        addr++;
-        count--;
+        return;
+    }
+
+    buf = (uint8_t*) malloc(count);
+    if (!buf)
+        throw bad_alloc();
+
+    try
+    {
+        for (uint32_t pos = 0; pos < count; pos += chunk)
+        {
+            chunk = min(count - pos, chunkSize());
+            _cache.read(addr + pos, buf + pos, chunk);
+        }
     }
+    catch (...)
+    {
+        free(buf);
+        throw;
+    }
+
+    for (uint32_t pos = 0; pos < count; pos++)
+        printf("%08x : %02x  %s\n", addr + pos, buf[pos], binstr(buf[pos], 8));
+    free(buf);
 }
 
 CommandMrf::CommandMrf() :
@@ -612,9 +897,12 @@ CommandMrf::invoke(char* argv[], int argc)
 {
     uint32_t addr;
     uint32_t count;
-    FILE* infile;
-    uint8_t buf[1024];
-    ssize_t fbytes;
+    uint32_t total;
+    uint32_t chunk;
+    FILE* outfile;
+    uint8_t* buf;
+    size_t fbytes;
+    struct timeval start;
 
     if (!argNum(argc, 4) ||
         !argUint32(argv[1], &addr) ||
@@ -622,31 +910,51 @@ CommandMrf::invoke(char* argv[], int argc)
         !connected())
         return;
 
-    infile = fopen(argv[3], "wb");
-    if (!infile)
+    outfile = fopen(argv[3], "wb");
+    if (!outfile)
         throw FileOpenError(errno);
 
+    chunk = chunkSize();
+    buf = (uint8_t*) malloc(chunk);
+    if (!buf)
+    {
+        fclose(outfile);
+        throw bad_alloc();
+    }
+
+    // File data goes through a stdio buffer as large as a chunk so the
+    // write is a copy into the OS cache while the next chunk is read
+    setvbuf(outfile, NULL, _IOFBF, chunk);
+
     try
     {
-        while (count > 0)
+        gettimeofday(&start, NULL);
+        for (total = count; count > 0; count -= chunk, addr += chunk)
         {
-            fbytes = min(count, sizeof(buf));
-            _samba.read(addr, buf, fbytes);
-            fbytes = fwrite(buf, 1, fbytes, infile);
-            if (fbytes < 0)
-                throw FileIoError(errno);
-            if ((size_t) fbytes != min(count, sizeof(buf)))
+            chunk = min(count, chunk);
+            _samba.read(addr, buf, chunk);
+            fbytes = fwrite(buf, 1, chunk, outfile);
+            if (fbytes != chunk)
+            {
+                if (ferror(outfile))
+                    throw FileIoError(errno);
                 throw FileShortError();
-            count -= fbytes;
+            }
+            progress(total - count + chunk, total, start);
         }
+        if (fflush(outfile) != 0)
+            throw FileIoError(errno);
     }
     catch (...)
     {
-        fclose(infile);
+        free(buf);
+        fclose(outfile);
         throw;
     }
 
-    fclose(infile);
+    free(buf);
+    fclose(outfile);
+    printf("Read %u bytes from address %08x\n", total, addr - total);
 }
 
 CommandMrw::CommandMrw() :
@@ -662,7 +970,7 @@ CommandMrw::invoke(char* argv[], int argc)
 {
     uint32_t addr;
     uint32_t count = 1;
-    uint32_t value;
+    uint32_t* values;
 
     if (!argRange(argc, 2, 3) ||
         !argUint32(argv[1], &addr) ||
@@ -670,13 +978,29 @@ CommandMrw::invoke(char* argv[], int argc)
         !connected())
         return;
 
-    while (count > 0)
+    if (count > UINT32_MAX / sizeof(uint32_t))
+    {
+        error("Number \"%s\" is out of range", argv[2]);
+        return;
+    }
+
+    values = (uint32_t*) malloc(count * sizeof(uint32_t));
+    if (!values)
+        throw bad_alloc();
+
+    try
+    {
+        readWords(addr, values, count);
+    }
+    catch (...)
     {
-        value = _samba.readWord(addr);
-        printf("%08x : %08x  %s\n", addr, value, binstr(value, 32));
-        addr += 4;
-        count--;
+        free(values);
+        throw;
     }
+
+    for (uint32_t i = 0; i < count; i++)
+        printf("%08x : %08x  %s\n", addr + i * 4, values[i], binstr(values[i], 32));
+    free(values);
 }
 
 CommandMwb::CommandMwb() :
@@ -722,6 +1046,7 @@ CommandMwb::invoke(char* argv[], int argc)
             return;
         }
 
+        _cache.invalidate(addr, 1);
         _samba.writeByte(addr, value);
         printf("%08x : %02x\n", addr, value);
         addr++;
@@ -740,11 +1065,13 @@ void
 CommandMwf::invoke(char* argv[], int argc)
 {
     uint32_t addr;
+    uint32_t chunk;
     FILE* infile;
-    uint8_t buf[1024];
-    ssize_t fsize;
-    ssize_t fbytes;
-    ssize_t fpos;
+    uint8_t* buf;
+    long fsize;
+    long fpos;
+    size_t fbytes;
+    struct timeval start;
 
     if (!argNum(argc, 3) ||
         !argUint32(argv[1], &addr) ||
@@ -755,6 +1082,15 @@ CommandMwf::invoke(char* argv[], int argc)
     if (!infile)
         throw FileOpenError(errno);
 
+    chunk = chunkSize();
+    buf = (uint8_t*) malloc(chunk);
+    if (!buf)
+    {
+        fclose(infile);
+        throw bad_alloc();
+    }
+    setvbuf(infile, NULL, _IOFBF, chunk);
+
     try
     {
         if (fseek(infile, 0, SEEK_END) != 0 ||
@@ -763,23 +1099,30 @@ CommandMwf::invoke(char* argv[], int argc)
 
         rewind(infile);
 
+        gettimeofday(&start, NULL);
         for (fpos = 0; fpos < fsize; fpos += fbytes)
         {
-            fbytes = fread(buf, 1, min((size_t)fsize, sizeof(buf)), infile);
-            if (fbytes < 0)
-                throw FileIoError(errno);
+            fbytes = fread(buf, 1, min((size_t)(fsize - fpos), (size_t) chunk), infile);
             if (fbytes == 0)
+            {
+                if (ferror(infile))
+                    throw FileIoError(errno);
                 break;
-            _samba.write(addr, buf, fbytes);
+            }
+            _cache.invalidate(addr + fpos, fbytes);
+            _samba.write(addr + fpos, buf, fbytes);
+            progress(fpos + fbytes, fsize, start);
         }
     }
     catch (...)
     {
+        free(buf);
         fclose(infile);
         throw;
     }
+    free(buf);
     fclose(infile);
-    printf("Wrote %ld bytes to address %08x\n", (long) fsize, addr);
+    printf("Wrote %ld bytes to address %08x\n", fpos, addr);
 }
 
 CommandMww::CommandMww() :
@@ -819,6 +1162,7 @@ CommandMww::invoke(char* argv[], int argc)
             free(input);
         }
 
+        _cache.invalidate(addr, 4);
         _samba.writeWord(addr, value);
         printf("%08x : %08x\n", addr, value);
         addr++;
@@ -927,7 +1271,7 @@ CommandPio::invoke(char* argv[], int argc)
 
     if (addr == 0)
     {
-        printf("Invalid PIO line \"%s\"\n", argv[1]);
+        fail("Invalid PIO line \"%s\"\n", argv[1]);
         return;
     }
 
@@ -941,6 +1285,7 @@ CommandPio::invoke(char* argv[], int argc)
     static const uint32_t PIO_CODR = 0x34;
     static const uint32_t PIO_ODSR = 0x38;
     static const uint32_t PIO_PDSR = 0x3c;
+    static const uint32_t PIO_ISR = 0x4c;
     static const uint32_t PIO_MDER = 0x50;
     static const uint32_t PIO_MDDR = 0x54;
     static const uint32_t PIO_MDSR = 0x58;
@@ -948,59 +1293,46 @@ CommandPio::invoke(char* argv[], int argc)
     static const uint32_t PIO_PUER = 0x64;
     static const uint32_t PIO_PUSR = 0x68;
     static const uint32_t PIO_ABSR = 0x70;
+    static const uint32_t PIO_WINDOW = 0x74;
 
     len = strlen(argv[2]);
     if (strncasecmp(argv[2], "status", len) == 0)
     {
+        uint32_t regs[PIO_WINDOW / sizeof(uint32_t)];
+
+        // Snapshot the register bank with two block reads that skip the
+        // PIO_ISR register since reading it clears pending interrupts
+        readWords(addr, regs, PIO_ISR / sizeof(uint32_t));
+        readWords(addr + PIO_ISR + 4, &regs[PIO_ISR / sizeof(uint32_t) + 1],
+                  (PIO_WINDOW - PIO_ISR - 4) / sizeof(uint32_t));
+        regs[PIO_ISR / sizeof(uint32_t)] = 0;
+
+#define PIO_REG(offset) regs[(offset) / sizeof(uint32_t)]
+
         if (line != 0xffffffff)
         {
-            uint32_t reg = _samba.readWord(addr + PIO_PSR);
-            printf("PIO Mode      : %s\n", (reg & line) ? "enable" : "disable");
-            
-            reg = _samba.readWord(addr + PIO_OSR);
-            printf("Direction     : %s\n", (reg & line) ? "output" : "input");
-
-            reg = _samba.readWord(addr + PIO_PDSR);
-            printf("Input Level   : %s\n", (reg & line)? "high" : "low");
-
-            reg = _samba.readWord(addr + PIO_ODSR);
-            printf("Output Level  : %s\n", (reg & line)? "high" : "low");
-            
-            reg = _samba.readWord(addr + PIO_MDSR);
-            printf("Multi-Drive   : %s\n", (reg & line)? "enable" : "disable");
-
-            reg = _samba.readWord(addr + PIO_PUSR);
-            printf("Pull-Up       : %s\n", (reg & line)? "disable" : "enable");
-
-            reg = _samba.readWord(addr + PIO_ABSR);
-            printf("Peripheral    : %s\n", (reg & line) ? "B" : "A");
+            printf("PIO Mode      : %s\n", (PIO_REG(PIO_PSR) & line) ? "enable" : "disable");
+            printf("Direction     : %s\n", (PIO_REG(PIO_OSR) & line) ? "output" : "input");
+            printf("Input Level   : %s\n", (PIO_REG(PIO_PDSR) & line)? "high" : "low");
+            printf("Output Level  : %s\n", (PIO_REG(PIO_ODSR) & line)? "high" : "low");
+            printf("Multi-Drive   : %s\n", (PIO_REG(PIO_MDSR) & line)? "enable" : "disable");
+            printf("Pull-Up       : %s\n", (PIO_REG(PIO_PUSR) & line)? "disable" : "enable");
+            printf("Peripheral    : %s\n", (PIO_REG(PIO_ABSR) & line) ? "B" : "A");
         }
         else
         {
             printf("                3      2 2      1 1\n");
             printf("                1      4 3      6 5      8 7      0\n");
-
-            uint32_t reg = _samba.readWord(addr + PIO_PSR);
-            printf("PIO Mode      : %s\n", binstr(reg, 32, 'D', 'E'));
-            
-            reg = _samba.readWord(addr + PIO_OSR);
-            printf("Direction     : %s\n", binstr(reg, 32, 'I', 'O'));
-
-            reg = _samba.readWord(addr + PIO_PDSR);
-            printf("Input Level   : %s\n", binstr(reg, 32, 'L', 'H'));
-
-            reg = _samba.readWord(addr + PIO_ODSR);
-            printf("Output Level  : %s\n", binstr(reg, 32, 'L', 'H'));
-            
-            reg = _samba.readWord(addr + PIO_MDSR);
-            printf("Multi-Drive   : %s\n", binstr(reg, 32, 'D', 'E'));
-            
-            reg = _samba.readWord(addr + PIO_PUSR);
-            printf("Pull-Up       : %s\n", binstr(reg, 32, 'E', 'D'));
-            
-            reg = _samba.readWord(addr + PIO_ABSR);
-            printf("Peripheral    : %s\n", binstr(reg, 32, 'A', 'B'));
+            printf("PIO Mode      : %s\n", binstr(PIO_REG(PIO_PSR), 32, 'D', 'E'));
+            printf("Direction     : %s\n", binstr(PIO_REG(PIO_OSR), 32, 'I', 'O'));
+            printf("Input Level   : %s\n", binstr(PIO_REG(PIO_PDSR), 32, 'L', 'H'));
+            printf("Output Level  : %s\n", binstr(PIO_REG(PIO_ODSR), 32, 'L', 'H'));
+            printf("Multi-Drive   : %s\n", binstr(PIO_REG(PIO_MDSR), 32, 'D', 'E'));
+            printf("Pull-Up       : %s\n", binstr(PIO_REG(PIO_PUSR), 32, 'E', 'D'));
+            printf("Peripheral    : %s\n", binstr(PIO_REG(PIO_ABSR), 32, 'A', 'B'));
         }
+
+#undef PIO_REG
     }
     else if (strncasecmp(argv[2], "high", len) == 0)
     {
@@ -1078,7 +1410,7 @@ CommandPio::invoke(char* argv[], int argc)
     }
     else
     {
-        printf("Invalid PIO operation\n");
+        fail("Invalid PIO operation\n");
         return;
     }
 }
@@ -1192,7 +1524,8 @@ CommandVerify::invoke(char* argv[], int argc)
         !flashable())
         return;
 
-    _flasher.verify(argv[1], 0);
+    if (!_flasher.verify(argv[1], 0))
+        _shell->errorFlag() = true;
 }
 
 CommandWrite::CommandWrite() :
@@ -1209,5 +1542,6 @@ CommandWrite::invoke(char* argv[], int argc)
         !flashable())
         return;
 
+    _cache.flush();
     _flasher.write(argv[1], 0);
 }
@@ -20,12 +20,14 @@
 #define _COMMAND_H
 
 #include <stdint.h>
+#include <sys/time.h>
 
 #include "Shell.h"
 #include "Samba.h"
 #include "PortFactory.h"
 #include "FlashFactory.h"
 #include "Flasher.h"
+#include "MemoryCache.h"
 
 class Command
 {
@@ -49,10 +51,13 @@ protected:
     static PortFactory _portFactory;
     static FlashFactory _flashFactory;
     static Flash::Ptr _flash;
+    static FlasherConsole _console;
     static Flasher _flasher;
+    static MemoryCache _cache;
     static bool _connected;
 
     bool error(const char* fmt, ...);
+    bool fail(const char* fmt, ...);
     bool argNum(int argc, int num);
     bool argRange(int argc, int min, int max);
     bool argUint32(const char* arg, uint32_t* value);
@@ -63,6 +68,10 @@ protected:
     bool connected();
     bool flashable();
 
+    void readWords(uint32_t addr, uint32_t* values, uint32_t count);
+    uint32_t chunkSize();
+    void progress(uint32_t done, uint32_t total, const struct timeval& start);
+
     void hexdump(uint32_t addr, uint8_t *buf, size_t count);
     const char* binstr(uint32_t value, int bits, char low = '0', char high = '1');
 
@@ -93,6 +102,13 @@ public:
     virtual void invoke(char* argv[], int argc);
 };
 
+class CommandCache : public Command
+{
+public:
+    CommandCache();
+    virtual void invoke(char* argv[], int argc);
+};
+
 class CommandConnect : public Command
 {
 public:
@@ -155,6 +171,13 @@ public:
     virtual void invoke(char* argv[], int argc);
 };
 
+class CommandImage : public Command
+{
+public:
+    CommandImage();
+    virtual void invoke(char* argv[], int argc);
+};
+
 class CommandInfo : public Command
 {
 public:
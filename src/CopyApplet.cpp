@@ -0,0 +1,39 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#include "CopyApplet.h"
+#include "WordCopyApplet.h"
+#include "BlockCopyApplet.h"
+
+#define EPROC_CM3   3
+#define EPROC_CM4   7
+
+CopyApplet*
+CopyApplet::create(Samba& samba, uint32_t addr)
+{
+    // Cortex-M cores can use the Thumb-2 applet that moves eight words
+    // per iteration while ARM7TDMI and ARM920T cores only run Thumb-1
+    switch (samba.eproc())
+    {
+    case EPROC_CM3:
+    case EPROC_CM4:
+        return new BlockCopyApplet(samba, addr);
+    default:
+        return new WordCopyApplet(samba, addr);
+    }
+}
@@ -0,0 +1,49 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef _COPYAPPLET_H
+#define _COPYAPPLET_H
+
+#include <memory>
+
+#include "Applet.h"
+
+class CopyApplet : public Applet
+{
+public:
+    CopyApplet(Samba& samba,
+               uint32_t addr,
+               uint8_t* code,
+               uint32_t size,
+               uint32_t start,
+               uint32_t stack,
+               uint32_t reset,
+               uint32_t signature)
+        : Applet(samba, addr, code, size, start, stack, reset, signature) {}
+    virtual ~CopyApplet() {}
+
+    virtual void setDstAddr(uint32_t dstAddr) = 0;
+    virtual void setSrcAddr(uint32_t srcAddr) = 0;
+    virtual void setWords(uint32_t words) = 0;
+
+    typedef std::auto_ptr<CopyApplet> Ptr;
+
+    static CopyApplet* create(Samba& samba, uint32_t addr);
+};
+
+#endif // _COPYAPPLET_H
@@ -0,0 +1,36 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef _CRC16_H
+#define _CRC16_H
+
+#include <stdint.h>
+
+// CRC-16/XMODEM: polynomial 0x1021, initial value 0, most significant
+// bit first.  A CRC may be continued across calls by passing it back in.
+class Crc16
+{
+public:
+    // Slicing-by-8 kernel that consumes eight bytes per table round
+    static uint16_t xmodem(const uint8_t* data, int len, uint16_t crc = 0);
+
+    // Classic one table lookup per byte, kept as the reference
+    static uint16_t xmodemBytewise(const uint8_t* data, int len, uint16_t crc = 0);
+};
+
+#endif // _CRC16_H
@@ -0,0 +1,810 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "Daemon.h"
+#include "MemorySerialPort.h"
+#include "FlashFactory.h"
+
+// Longest request line accepted from a client
+#define DAEMON_LINE_MAX     4096
+// Largest inline image accepted from a client
+#define DAEMON_DATA_MAX     (16 * 1024 * 1024)
+
+// Virtual ports named "image:CHIPID[:FILE]" run jobs against an emulated
+// device so scripts can be tried without a board
+#define DAEMON_IMAGE_PREFIX "image:"
+
+static uint64_t
+pageHash(const uint8_t* data, uint32_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    // FNV-1a
+    for (uint32_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+DaemonJob::DaemonJob(int fd)
+    : fd(fd), erase(false), write(false), verify(false), read(false),
+      offset(0), readSize(0), gone(false), _done(false)
+{
+    pthread_mutex_init(&_mutex, NULL);
+    pthread_cond_init(&_cond, NULL);
+}
+
+DaemonJob::~DaemonJob()
+{
+    pthread_cond_destroy(&_cond);
+    pthread_mutex_destroy(&_mutex);
+}
+
+void
+DaemonJob::reply(const char* fmt, ...)
+{
+    char line[DAEMON_LINE_MAX];
+    va_list ap;
+    int len;
+
+    va_start(ap, fmt);
+    len = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (len < 0)
+        return;
+    if (len >= (int) sizeof(line))
+        len = sizeof(line) - 1;
+
+    replyData((const uint8_t*) line, len);
+}
+
+void
+DaemonJob::replyData(const uint8_t* data, uint32_t size)
+{
+    ssize_t bytes;
+
+    while (!gone && size > 0)
+    {
+        bytes = ::write(fd, data, size);
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes <= 0)
+        {
+            gone = true;
+            break;
+        }
+        data += bytes;
+        size -= bytes;
+    }
+}
+
+void
+DaemonJob::finish()
+{
+    pthread_mutex_lock(&_mutex);
+    _done = true;
+    pthread_cond_signal(&_cond);
+    pthread_mutex_unlock(&_mutex);
+}
+
+void
+DaemonJob::wait()
+{
+    pthread_mutex_lock(&_mutex);
+    while (!_done)
+        pthread_cond_wait(&_cond, &_mutex);
+    pthread_mutex_unlock(&_mutex);
+}
+
+ImageCache::ImageCache() : _clock(0)
+{
+    pthread_mutex_init(&_mutex, NULL);
+}
+
+ImageCache::~ImageCache()
+{
+    pthread_mutex_destroy(&_mutex);
+}
+
+void
+ImageCache::load(const std::string& path, std::vector<uint8_t>& data)
+{
+    struct stat st;
+    ImageMap::iterator it;
+    ImageMap::iterator oldest;
+    FILE* infile;
+
+    if (stat(path.c_str(), &st) != 0)
+        throw DaemonError(path + ": " + strerror(errno));
+
+    pthread_mutex_lock(&_mutex);
+    it = _images.find(path);
+    if (it != _images.end() &&
+        it->second.mtime == st.st_mtime &&
+        it->second.size == st.st_size)
+    {
+        it->second.used = ++_clock;
+        data = it->second.data;
+        pthread_mutex_unlock(&_mutex);
+        return;
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    // Files are read outside the lock so a slow load does not hold up
+    // jobs for other images
+    infile = fopen(path.c_str(), "rb");
+    if (!infile)
+        throw DaemonError(path + ": " + strerror(errno));
+    data.resize(st.st_size);
+    if (st.st_size > 0 && fread(&data[0], 1, st.st_size, infile) != (size_t) st.st_size)
+    {
+        fclose(infile);
+        throw DaemonError(path + ": short read");
+    }
+    fclose(infile);
+
+    pthread_mutex_lock(&_mutex);
+    if (_images.size() >= MAX_IMAGES && _images.find(path) == _images.end())
+    {
+        oldest = _images.begin();
+        for (it = _images.begin(); it != _images.end(); it++)
+        {
+            if (it->second.used < oldest->second.used)
+                oldest = it;
+        }
+        _images.erase(oldest);
+    }
+    Image& image = _images[path];
+    image.mtime = st.st_mtime;
+    image.size = st.st_size;
+    image.used = ++_clock;
+    image.data = data;
+    pthread_mutex_unlock(&_mutex);
+}
+
+PortWorker::PortWorker(const std::string& port)
+    : _port(port), _session(this), _job(NULL)
+{
+    pthread_mutex_init(&_mutex, NULL);
+    pthread_cond_init(&_cond, NULL);
+}
+
+PortWorker::~PortWorker()
+{
+    pthread_cond_destroy(&_cond);
+    pthread_mutex_destroy(&_mutex);
+}
+
+void
+PortWorker::start()
+{
+    if (pthread_create(&_thread, NULL, run, this) != 0)
+        throw DaemonError("Unable to start worker for " + _port);
+    pthread_detach(_thread);
+}
+
+void*
+PortWorker::run(void* arg)
+{
+    ((PortWorker*) arg)->loop();
+    return NULL;
+}
+
+void
+PortWorker::submit(DaemonJob* job)
+{
+    pthread_mutex_lock(&_mutex);
+    // The position is sent under the lock so it always precedes the
+    // replies of the worker
+    job->reply("queued %u\n", (unsigned) _queue.size() + (_job ? 1 : 0));
+    _queue.push_back(job);
+    pthread_cond_signal(&_cond);
+    pthread_mutex_unlock(&_mutex);
+}
+
+uint32_t
+PortWorker::pending()
+{
+    uint32_t count;
+
+    pthread_mutex_lock(&_mutex);
+    count = _queue.size() + (_job ? 1 : 0);
+    pthread_mutex_unlock(&_mutex);
+
+    return count;
+}
+
+std::string
+PortWorker::state()
+{
+    char line[DAEMON_LINE_MAX];
+    uint32_t known = 0;
+
+    pthread_mutex_lock(&_mutex);
+    for (uint32_t page = 0; page < _pageKnown.size(); page++)
+        known += _pageKnown[page];
+    // The page map only exists while the session is connected
+    snprintf(line, sizeof(line), "port %s %s queued=%u known=%u/%u\n",
+             _port.c_str(), _pageKnown.empty() ? "idle" : "connected",
+             (unsigned) _queue.size() + (_job ? 1 : 0),
+             known, (unsigned) _pageKnown.size());
+    pthread_mutex_unlock(&_mutex);
+
+    return line;
+}
+
+void
+PortWorker::loop()
+{
+    DaemonJob* job;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&_mutex);
+        while (_queue.empty())
+            pthread_cond_wait(&_cond, &_mutex);
+        job = _queue.front();
+        _queue.pop_front();
+        _job = job;
+        pthread_mutex_unlock(&_mutex);
+
+        try
+        {
+            runJob(job);
+            job->reply("ok\n");
+        }
+        catch (std::exception& e)
+        {
+            job->reply("error %s\n", e.what());
+            // The device state is unknown after a failure so the next
+            // job starts from a fresh connection
+            _session.close();
+        }
+
+        pthread_mutex_lock(&_mutex);
+        _job = NULL;
+        if (!_session.isOpen())
+        {
+            _pageHash.clear();
+            _pageKnown.clear();
+        }
+        pthread_mutex_unlock(&_mutex);
+
+        job->finish();
+    }
+}
+
+void
+PortWorker::connect()
+{
+    FlashFactory flashFactory;
+    const Device* dev;
+    MemorySerialPort* image;
+    std::string spec;
+    std::string::size_type colon;
+    uint32_t pages;
+
+    if (_session.isOpen())
+        return;
+
+    if (_port.compare(0, strlen(DAEMON_IMAGE_PREFIX), DAEMON_IMAGE_PREFIX) == 0)
+    {
+        spec = _port.substr(strlen(DAEMON_IMAGE_PREFIX));
+        colon = spec.find(':');
+        dev = flashFactory.device(strtoul(spec.substr(0, colon).c_str(), NULL, 0));
+        if (!dev)
+            throw DaemonError("Unsupported chip ID in " + _port);
+
+        image = new MemorySerialPort(_port);
+        SerialPort::Ptr port(image);
+        image->mapDevice(*dev);
+        if (colon != std::string::npos)
+            image->load(spec.substr(colon + 1), dev->addr);
+        _session.open(port);
+    }
+    else
+    {
+        _session.open(_port);
+    }
+
+    pages = _session.flashSize() / _session.pageSize();
+    pthread_mutex_lock(&_mutex);
+    _pageHash.assign(pages, 0);
+    _pageKnown.assign(pages, false);
+    pthread_mutex_unlock(&_mutex);
+}
+
+void
+PortWorker::runJob(DaemonJob* job)
+{
+    uint32_t pageSize;
+    uint32_t first;
+    uint32_t numPages;
+    uint32_t byteErrors;
+    std::vector<uint8_t> page;
+    std::vector<uint8_t> buffer;
+
+    connect();
+    pageSize = _session.pageSize();
+    first = job->offset / pageSize;
+    numPages = (job->data.size() + pageSize - 1) / pageSize;
+
+    if (job->erase)
+    {
+        _session.erase();
+        page.assign(pageSize, 0xff);
+        pthread_mutex_lock(&_mutex);
+        _pageHash.assign(_pageHash.size(), pageHash(&page[0], pageSize));
+        _pageKnown.assign(_pageKnown.size(), true);
+        pthread_mutex_unlock(&_mutex);
+    }
+
+    if (job->write)
+        writeChanged(job);
+
+    if (job->verify)
+    {
+        if (!_session.verify(job->offset, job->data.empty() ? NULL : &job->data[0],
+                             job->data.size(), byteErrors))
+        {
+            pthread_mutex_lock(&_mutex);
+            for (uint32_t i = 0; i < numPages; i++)
+                _pageKnown[first + i] = false;
+            pthread_mutex_unlock(&_mutex);
+            throw DaemonError("verify failed");
+        }
+
+        // Whole pages that verified are known to hold the image
+        pthread_mutex_lock(&_mutex);
+        for (uint32_t i = 0; i < job->data.size() / pageSize; i++)
+        {
+            _pageHash[first + i] = pageHash(&job->data[i * pageSize], pageSize);
+            _pageKnown[first + i] = true;
+        }
+        pthread_mutex_unlock(&_mutex);
+    }
+
+    if (job->read)
+    {
+        buffer.resize(job->readSize);
+        _session.read(job->offset, buffer.empty() ? NULL : &buffer[0], buffer.size());
+        job->reply("data %u\n", (unsigned) buffer.size());
+        if (!buffer.empty())
+            job->replyData(&buffer[0], buffer.size());
+    }
+}
+
+void
+PortWorker::writeChanged(DaemonJob* job)
+{
+    uint32_t pageSize = _session.pageSize();
+    uint32_t size = job->data.size();
+    uint32_t first = job->offset / pageSize;
+    uint32_t numPages = (size + pageSize - 1) / pageSize;
+    uint32_t skipped = 0;
+    uint32_t start;
+    uint32_t end;
+    std::vector<uint64_t> hashes(numPages);
+    std::vector<uint8_t> page(pageSize);
+
+    if (job->offset % pageSize != 0)
+        throw DaemonError("offset is not a multiple of the page size");
+    if (first + numPages > _pageHash.size())
+        throw DaemonError("image exceeds the flash size");
+
+    // Hash each page as it will land in flash, padded with the erased value
+    for (uint32_t i = 0; i < numPages; i++)
+    {
+        start = i * pageSize;
+        end = std::min(start + pageSize, size);
+        memset(&page[0], 0xff, pageSize);
+        memcpy(&page[0], &job->data[start], end - start);
+        hashes[i] = pageHash(&page[0], pageSize);
+    }
+
+    // Write each run of pages that differ from what the device is known
+    // to hold.  A page is forgotten before it is written so a failure
+    // part way through never leaves a stale hash behind.
+    for (uint32_t i = 0; i < numPages; )
+    {
+        if (_pageKnown[first + i] && _pageHash[first + i] == hashes[i])
+        {
+            skipped++;
+            i++;
+            continue;
+        }
+
+        start = i;
+        while (i < numPages &&
+               !(_pageKnown[first + i] && _pageHash[first + i] == hashes[i]))
+        {
+            pthread_mutex_lock(&_mutex);
+            _pageKnown[first + i] = false;
+            pthread_mutex_unlock(&_mutex);
+            i++;
+        }
+
+        end = std::min(i * pageSize, size);
+        _session.write(job->offset + start * pageSize, &job->data[start * pageSize],
+                       end - start * pageSize);
+
+        pthread_mutex_lock(&_mutex);
+        for (uint32_t j = start; j < i; j++)
+        {
+            _pageHash[first + j] = hashes[j];
+            _pageKnown[first + j] = true;
+        }
+        pthread_mutex_unlock(&_mutex);
+    }
+
+    if (skipped)
+        job->reply("status %u of %u pages unchanged\n", skipped, numPages);
+}
+
+void
+PortWorker::onStatus(const char* message, ...)
+{
+    char line[DAEMON_LINE_MAX];
+    va_list ap;
+
+    va_start(ap, message);
+    vsnprintf(line, sizeof(line), message, ap);
+    va_end(ap);
+
+    // Status messages end with their own newline
+    _job->reply("status %s", line);
+}
+
+void
+PortWorker::onProgress(int num, int div)
+{
+    _job->reply("progress %d %d\n", num, div);
+}
+
+bool
+PortWorker::isCancelled()
+{
+    return _job->gone;
+}
+
+Daemon::Daemon(const std::string& path)
+    : _path(path), _listen(-1), _stopped(false)
+{
+    pthread_mutex_init(&_mutex, NULL);
+}
+
+Daemon::~Daemon()
+{
+    if (_listen >= 0)
+    {
+        close(_listen);
+        unlink(_path.c_str());
+    }
+    pthread_mutex_destroy(&_mutex);
+}
+
+PortWorker*
+Daemon::worker(const std::string& port)
+{
+    std::map<std::string, PortWorker*>::iterator it;
+    PortWorker* found = NULL;
+
+    pthread_mutex_lock(&_mutex);
+    if (port == "any")
+    {
+        // Pick the least busy of the configured ports
+        for (it = _workers.begin(); it != _workers.end(); it++)
+        {
+            if (!found || it->second->pending() < found->pending())
+                found = it->second;
+        }
+    }
+    else
+    {
+        // Clients only get the ports given on the command line so they
+        // cannot open other devices or load files through image: ports
+        it = _workers.find(port);
+        if (it != _workers.end())
+            found = it->second;
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    if (!found)
+        throw DaemonError(port == "any" ? "no ports are configured" :
+                          "port " + port + " is not configured");
+
+    return found;
+}
+
+void
+Daemon::addPort(const std::string& port)
+{
+    PortWorker* added;
+
+    pthread_mutex_lock(&_mutex);
+    if (_workers.find(port) == _workers.end())
+    {
+        // Workers live until the daemon exits so their threads never
+        // outlive them
+        added = new PortWorker(port);
+        added->start();
+        _workers[port] = added;
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+void
+Daemon::serve()
+{
+    struct sockaddr_un addr;
+    struct stat st;
+    mode_t mask;
+    int fd;
+    pthread_t thread;
+    std::pair<Daemon*, int>* arg;
+
+    if (_path.size() >= sizeof(addr.sun_path))
+        throw DaemonError("socket path is too long");
+
+    _listen = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (_listen < 0)
+        throw DaemonError(std::string("socket: ") + strerror(errno));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, _path.c_str());
+    // Only a stale socket is removed, never some other file at the path
+    if (lstat(_path.c_str(), &st) == 0)
+    {
+        if (!S_ISSOCK(st.st_mode))
+            throw DaemonError(_path + ": exists and is not a socket");
+        unlink(_path.c_str());
+    }
+
+    // Jobs can read and write any configured device so the socket is
+    // only open to the user running the daemon
+    mask = umask(077);
+    if (bind(_listen, (struct sockaddr*) &addr, sizeof(addr)) != 0)
+    {
+        umask(mask);
+        throw DaemonError(_path + ": " + strerror(errno));
+    }
+    umask(mask);
+    if (chmod(_path.c_str(), 0600) != 0 || listen(_listen, 16) != 0)
+        throw DaemonError(_path + ": " + strerror(errno));
+
+    while (!_stopped)
+    {
+        fd = accept(_listen, NULL, NULL);
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw DaemonError(std::string("accept: ") + strerror(errno));
+        }
+
+        arg = new std::pair<Daemon*, int>(this, fd);
+        if (pthread_create(&thread, NULL, client, arg) != 0)
+        {
+            close(fd);
+            delete arg;
+            continue;
+        }
+        pthread_detach(thread);
+    }
+}
+
+void
+Daemon::stop()
+{
+    _stopped = true;
+}
+
+void*
+Daemon::client(void* arg)
+{
+    std::pair<Daemon*, int>* client = (std::pair<Daemon*, int>*) arg;
+
+    client->first->handle(client->second);
+    close(client->second);
+    delete client;
+
+    return NULL;
+}
+
+static bool
+readLine(int fd, char* line, int size)
+{
+    int len = 0;
+    char c;
+
+    while (len < size - 1)
+    {
+        if (read(fd, &c, 1) != 1)
+            return false;
+        if (c == '\n')
+            break;
+        if (c != '\r')
+            line[len++] = c;
+    }
+    line[len] = '\0';
+
+    return true;
+}
+
+static bool
+readAll(int fd, uint8_t* data, uint32_t size)
+{
+    ssize_t bytes;
+
+    while (size > 0)
+    {
+        bytes = read(fd, data, size);
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes <= 0)
+            return false;
+        data += bytes;
+        size -= bytes;
+    }
+
+    return true;
+}
+
+void
+Daemon::parse(DaemonJob& job, char* line)
+{
+    char* token;
+    char* value;
+    char* save;
+    char* end;
+    uint32_t number;
+    uint32_t size = 0;
+
+    token = strtok_r(line, " \t", &save);
+    if (!token || strcmp(token, "job") != 0)
+        throw DaemonError("expected \"job\" or \"ports\"");
+
+    while ((token = strtok_r(NULL, " \t", &save)) != NULL)
+    {
+        value = strchr(token, '=');
+        if (!value)
+            throw DaemonError(std::string("missing value for ") + token);
+        *value++ = '\0';
+
+        if (strcmp(token, "port") == 0)
+        {
+            job.port = value;
+        }
+        else if (strcmp(token, "ops") == 0)
+        {
+            for (; *value; value++)
+            {
+                switch (*value)
+                {
+                case 'e': job.erase = true; break;
+                case 'w': job.write = true; break;
+                case 'v': job.verify = true; break;
+                case 'r': job.read = true; break;
+                default:
+                    throw DaemonError(std::string("unknown operation ") + *value);
+                }
+            }
+        }
+        else if (strcmp(token, "file") == 0)
+        {
+            job.image = value;
+        }
+        else if (strcmp(token, "offset") == 0 ||
+                 strcmp(token, "size") == 0 ||
+                 strcmp(token, "read") == 0)
+        {
+            number = strtoul(value, &end, 0);
+            if (*value == '\0' || *end != '\0')
+                throw DaemonError(std::string("invalid number for ") + token);
+            if (strcmp(token, "offset") == 0)
+                job.offset = number;
+            else if (strcmp(token, "size") == 0)
+                size = number;
+            else
+                job.readSize = number;
+        }
+        else
+        {
+            throw DaemonError(std::string("unknown field ") + token);
+        }
+    }
+
+    if (job.port.empty())
+        throw DaemonError("no port given");
+    if (!job.erase && !job.write && !job.verify && !job.read)
+        throw DaemonError("no operations given");
+    if ((job.write || job.verify) && job.image.empty() && size == 0)
+        throw DaemonError("write and verify need a file or inline data");
+    if (!job.image.empty() && size != 0)
+        throw DaemonError("file and inline data are exclusive");
+    if (size > DAEMON_DATA_MAX)
+        throw DaemonError("inline data is too large");
+
+    // Inline image bytes follow the request line
+    if (size != 0)
+    {
+        job.data.resize(size);
+        if (!readAll(job.fd, &job.data[0], size))
+            throw DaemonError("short inline data");
+    }
+    else if (!job.image.empty())
+    {
+        _images.load(job.image, job.data);
+    }
+}
+
+void
+Daemon::listPorts(int fd)
+{
+    std::map<std::string, PortWorker*>::iterator it;
+    DaemonJob job(fd);
+
+    pthread_mutex_lock(&_mutex);
+    for (it = _workers.begin(); it != _workers.end(); it++)
+        job.reply("%s", it->second->state().c_str());
+    pthread_mutex_unlock(&_mutex);
+    job.reply("ok\n");
+}
+
+void
+Daemon::handle(int fd)
+{
+    char line[DAEMON_LINE_MAX];
+    DaemonJob job(fd);
+
+    if (!readLine(fd, line, sizeof(line)))
+        return;
+
+    if (strcmp(line, "ports") == 0)
+    {
+        listPorts(fd);
+        return;
+    }
+
+    try
+    {
+        parse(job, line);
+        worker(job.port)->submit(&job);
+    }
+    catch (std::exception& e)
+    {
+        job.reply("error %s\n", e.what());
+        return;
+    }
+
+    job.wait();
+}
@@ -0,0 +1,164 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef _DAEMON_H
+#define _DAEMON_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <exception>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "Session.h"
+
+class DaemonError : public std::exception
+{
+public:
+    DaemonError(const std::string& message) : exception(), _message(message) {}
+    virtual ~DaemonError() throw() {}
+    virtual const char* what() const throw() { return _message.c_str(); }
+private:
+    std::string _message;
+};
+
+// One request from a client.  The connection thread fills it in and the
+// port worker runs it, streaming replies to the client socket.
+class DaemonJob
+{
+public:
+    DaemonJob(int fd);
+    virtual ~DaemonJob();
+
+    void reply(const char* fmt, ...);
+    void replyData(const uint8_t* data, uint32_t size);
+    void finish();
+    void wait();
+
+    int fd;
+    std::string port;
+    bool erase;
+    bool write;
+    bool verify;
+    bool read;
+    uint32_t offset;
+    uint32_t readSize;
+    std::vector<uint8_t> data;
+    std::string image;      // Image cache key or empty for inline data
+    bool gone;              // Client closed its end of the socket
+
+private:
+    pthread_mutex_t _mutex;
+    pthread_cond_t _cond;
+    bool _done;
+};
+
+// Images loaded from files, kept while the file is unchanged so repeated
+// jobs skip reading them
+class ImageCache
+{
+public:
+    ImageCache();
+    virtual ~ImageCache();
+
+    void load(const std::string& path, std::vector<uint8_t>& data);
+
+    static const uint32_t MAX_IMAGES = 16;
+
+private:
+    class Image
+    {
+    public:
+        time_t mtime;
+        off_t size;
+        uint32_t used;
+        std::vector<uint8_t> data;
+    };
+    typedef std::map<std::string, Image> ImageMap;
+
+    pthread_mutex_t _mutex;
+    ImageMap _images;
+    uint32_t _clock;
+};
+
+// Owns one serial port and runs its jobs in order on a thread of its own.
+// The session stays connected between jobs and the worker remembers the
+// hash of every page it has written or verified so that identical pages
+// are not written again.
+class PortWorker : private FlasherObserver
+{
+public:
+    PortWorker(const std::string& port);
+    virtual ~PortWorker();
+
+    void start();
+    void submit(DaemonJob* job);
+    uint32_t pending();
+    const std::string& port() { return _port; }
+    std::string state();
+
+private:
+    std::string _port;
+    Session _session;
+    pthread_t _thread;
+    pthread_mutex_t _mutex;
+    pthread_cond_t _cond;
+    std::deque<DaemonJob*> _queue;
+    DaemonJob* _job;
+    std::vector<uint64_t> _pageHash;
+    std::vector<bool> _pageKnown;
+
+    static void* run(void* arg);
+    void loop();
+    void runJob(DaemonJob* job);
+    void connect();
+    void writeChanged(DaemonJob* job);
+
+    void onStatus(const char* message, ...);
+    void onProgress(int num, int div);
+    bool isCancelled();
+};
+
+class Daemon
+{
+public:
+    Daemon(const std::string& path);
+    virtual ~Daemon();
+
+    void addPort(const std::string& port);
+    void serve();
+    void stop();
+
+private:
+    std::string _path;
+    int _listen;
+    volatile bool _stopped;
+    ImageCache _images;
+    pthread_mutex_t _mutex;
+    std::map<std::string, PortWorker*> _workers;
+
+    static void* client(void* arg);
+    void handle(int fd);
+    void parse(DaemonJob& job, char* line);
+    PortWorker* worker(const std::string& port);
+    void listPorts(int fd);
+};
+
+#endif // _DAEMON_H
@@ -0,0 +1,370 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#include "Device.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Page and full erase timeouts in ms for each flash controller family
+#define EFC_TIMING      10, 200
+#define EEFC_TIMING     20, 2000
+#define SAM4S_TIMING    20, 10000
+#define CALW_TIMING     10, 500
+
+struct DeviceEntry
+{
+    uint32_t chipId;
+    const char* name;
+    Device::FlashType type;
+    uint32_t addr;
+    uint32_t pages;
+    uint32_t size;
+    uint32_t planes;
+    uint32_t lockRegions;
+    uint32_t reserved;
+    uint32_t user;
+    uint32_t stack;
+    uint32_t regs;
+    uint32_t sramStart;
+    uint32_t sramEnd;
+    uint32_t flags;
+    uint32_t pageTimeout;
+    uint32_t eraseTimeout;
+};
+
+static const DeviceEntry builtinDevices[] =
+{
+    //
+    // SAM7SE
+    //
+    { 0x272a0a40, "AT91SAM7SE512", Device::FLASH_EFC, 0x00100000, 2048, 256, 2, 32, 0, 0x00202000, 0x00208000, 0xffffff60, 0x00200000, 0x00208000, Device::CAN_BOOTFLASH, EFC_TIMING },
+    { 0x272a0940, "AT91SAM7SE256", Device::FLASH_EFC, 0x00100000, 1024, 256, 1, 16, 0, 0x00202000, 0x00208000, 0xffffff60, 0x00200000, 0x00208000, Device::CAN_BOOTFLASH, EFC_TIMING },
+    { 0x272a0340, "AT91SAM7SE32", Device::FLASH_EFC, 0x00100000, 256, 128, 1, 8, 0, 0x00201400, 0x00201c00, 0xffffff60, 0x00200000, 0x00202000, Device::CAN_BOOTFLASH, EFC_TIMING },
+    //
+    // SAM7S
+    //
+    { 0x270b0a40, "AT91SAM7S512", Device::FLASH_EFC, 0x00100000, 2048, 256, 2, 32, 0, 0x00202000, 0x00210000, 0xffffff60, 0x00200000, 0x00210000, 0, EFC_TIMING },
+    { 0x270d0940, "AT91SAM7S256", Device::FLASH_EFC, 0x00100000, 1024, 256, 1, 16, 0, 0x00202000, 0x00210000, 0xffffff60, 0x00200000, 0x00210000, 0, EFC_TIMING }, // A
+    { 0x270b0940, "AT91SAM7S256", Device::FLASH_EFC, 0x00100000, 1024, 256, 1, 16, 0, 0x00202000, 0x00210000, 0xffffff60, 0x00200000, 0x00210000, 0, EFC_TIMING }, // B/C
+    { 0x270c0740, "AT91SAM7S128", Device::FLASH_EFC, 0x00100000, 512, 256, 1, 8, 0, 0x00202000, 0x00208000, 0xffffff60, 0x00200000, 0x00208000, 0, EFC_TIMING }, // A
+    { 0x270a0740, "AT91SAM7S128", Device::FLASH_EFC, 0x00100000, 512, 256, 1, 8, 0, 0x00202000, 0x00208000, 0xffffff60, 0x00200000, 0x00208000, 0, EFC_TIMING }, // B/C
+    { 0x27090540, "AT91SAM7S64", Device::FLASH_EFC, 0x00100000, 512, 128, 1, 16, 0, 0x00202000, 0x00204000, 0xffffff60, 0x00200000, 0x00204000, 0, EFC_TIMING },
+    { 0x27080340, "AT91SAM7S32", Device::FLASH_EFC, 0x00100000, 256, 128, 1, 8, 0, 0x00201400, 0x00202000, 0xffffff60, 0x00200000, 0x00202000, 0, EFC_TIMING },
+    { 0x27050240, "AT91SAM7S16", Device::FLASH_EFC, 0x00100000, 256, 64, 1, 8, 0, 0x00200000, 0x00200e00, 0xffffff60, 0x00200000, 0x00201000, 0, EFC_TIMING },
+    //
+    // SAM7XC
+    //
+    { 0x271c0a40, "AT91SAMXC512", Device::FLASH_EFC, 0x00100000, 2048, 256, 2, 32, 0, 0x00202000, 0x00220000, 0xffffff60, 0x00200000, 0x00220000, Device::CAN_BOOTFLASH, EFC_TIMING },
+    { 0x271b0940, "AT91SAMXC256", Device::FLASH_EFC, 0x00100000, 1024, 256, 1, 16, 0, 0x00202000, 0x00210000, 0xffffff60, 0x00200000, 0x00210000, Device::CAN_BOOTFLASH, EFC_TIMING },
+    { 0x271a0740, "AT91SAMXC128", Device::FLASH_EFC, 0x00100000, 512, 256, 1, 8, 0, 0x00202000, 0x00208000, 0xffffff60, 0x00200000, 0x00208000, Device::CAN_BOOTFLASH, EFC_TIMING },
+    //
+    // SAM7X
+    //
+    { 0x275c0a40, "AT91SAMX512", Device::FLASH_EFC, 0x00100000, 2048, 256, 2, 32, 0, 0x00202000, 0x00220000, 0xffffff60, 0x00200000, 0x00220000, Device::CAN_BOOTFLASH, EFC_TIMING },
+    { 0x275b0940, "AT91SAMX256", Device::FLASH_EFC, 0x00100000, 1024, 256, 1, 16, 0, 0x00202000, 0x00210000, 0xffffff60, 0x00200000, 0x00210000, Device::CAN_BOOTFLASH, EFC_TIMING },
+    { 0x275a0740, "AT91SAMX128", Device::FLASH_EFC, 0x00100000, 512, 256, 1, 8, 0, 0x00202000, 0x00208000, 0xffffff60, 0x00200000, 0x00208000, Device::CAN_BOOTFLASH, EFC_TIMING },
+    //
+    // SAM4LS
+    //
+    { 0x2b0b0ae0, "ATSAM4LS8", Device::FLASH_CALW, 0x00000000, 1024, 512, 1, 16, 0x4000, 0x20001000, 0x20004000, 0x400a0000, 0x20000000, 0x20010000, Device::HAS_USERPAGE, CALW_TIMING }, // ATSAM4LS8C (Rev A) 512K/64K
+    { 0x2b0a09e0, "ATSAM4LS4", Device::FLASH_CALW, 0x00000000, 512, 512, 1, 16, 0x4000, 0x20001000, 0x20004000, 0x400a0000, 0x20000000, 0x20008000, Device::HAS_USERPAGE, CALW_TIMING }, // ATSAM4LS4C (Rev A) 256K/32K
+    { 0x2b0a07e0, "ATSAM4LS2", Device::FLASH_CALW, 0x00000000, 256, 512, 1, 16, 0x4000, 0x20001000, 0x20004000, 0x400a0000, 0x20000000, 0x20008000, Device::HAS_USERPAGE, CALW_TIMING }, // ATSAM4LS2C (Rev A) 128K/32K
+    //
+    // SAM4S
+    //
+    { 0x288c0ce0, "ATSAM4S16", Device::FLASH_EEFC, 0x00400000, 2048, 512, 1, 128, 0, 0x20001000, 0x20020000, 0x400e0a00, 0x20000000, 0x20020000, 0, SAM4S_TIMING }, // A
+    { 0x289c0ce0, "ATSAM4S16", Device::FLASH_EEFC, 0x00400000, 2048, 512, 1, 128, 0, 0x20001000, 0x20020000, 0x400e0a00, 0x20000000, 0x20020000, 0, SAM4S_TIMING }, // B
+    { 0x28ac0ce0, "ATSAM4S16", Device::FLASH_EEFC, 0x00400000, 2048, 512, 1, 128, 0, 0x20001000, 0x20020000, 0x400e0a00, 0x20000000, 0x20020000, 0, SAM4S_TIMING }, // C
+    { 0x288c0ae0, "ATSAM4S8", Device::FLASH_EEFC, 0x00400000, 1024, 512, 1, 64, 0, 0x20001000, 0x20020000, 0x400e0a00, 0x20000000, 0x20020000, 0, SAM4S_TIMING }, // A
+    { 0x289c0ae0, "ATSAM4S8", Device::FLASH_EEFC, 0x00400000, 1024, 512, 1, 64, 0, 0x20001000, 0x20020000, 0x400e0a00, 0x20000000, 0x20020000, 0, SAM4S_TIMING }, // B
+    { 0x28ac0ae0, "ATSAM4S8", Device::FLASH_EEFC, 0x00400000, 1024, 512, 1, 64, 0, 0x20001000, 0x20020000, 0x400e0a00, 0x20000000, 0x20020000, 0, SAM4S_TIMING }, // C
+    //
+    // SAM3N
+    //
+    { 0x29340960, "ATSAM3N4", Device::FLASH_EEFC, 0x00400000, 1024, 256, 1, 16, 0, 0x20001000, 0x20006000, 0x400e0a00, 0x20000000, 0x20006000, 0, EEFC_TIMING }, // A
+    { 0x29440960, "ATSAM3N4", Device::FLASH_EEFC, 0x00400000, 1024, 256, 1, 16, 0, 0x20001000, 0x20006000, 0x400e0a00, 0x20000000, 0x20006000, 0, EEFC_TIMING }, // B
+    { 0x29540960, "ATSAM3N4", Device::FLASH_EEFC, 0x00400000, 1024, 256, 1, 16, 0, 0x20001000, 0x20006000, 0x400e0a00, 0x20000000, 0x20006000, 0, EEFC_TIMING }, // C
+    { 0x29390760, "ATSAM3N2", Device::FLASH_EEFC, 0x00400000, 512, 256, 1, 8, 0, 0x20001000, 0x20004000, 0x400e0a00, 0x20000000, 0x20004000, 0, EEFC_TIMING }, // A
+    { 0x29490760, "ATSAM3N2", Device::FLASH_EEFC, 0x00400000, 512, 256, 1, 8, 0, 0x20001000, 0x20004000, 0x400e0a00, 0x20000000, 0x20004000, 0, EEFC_TIMING }, // B
+    { 0x29590760, "ATSAM3N2", Device::FLASH_EEFC, 0x00400000, 512, 256, 1, 8, 0, 0x20001000, 0x20004000, 0x400e0a00, 0x20000000, 0x20004000, 0, EEFC_TIMING }, // C
+    { 0x29380560, "ATSAM3N1", Device::FLASH_EEFC, 0x00400000, 256, 256, 1, 4, 0, 0x20000800, 0x20002000, 0x400e0a00, 0x20000000, 0x20002000, 0, EEFC_TIMING }, // A
+    { 0x29480560, "ATSAM3N1", Device::FLASH_EEFC, 0x00400000, 256, 256, 1, 4, 0, 0x20000800, 0x20002000, 0x400e0a00, 0x20000000, 0x20002000, 0, EEFC_TIMING }, // B
+    { 0x29580560, "ATSAM3N1", Device::FLASH_EEFC, 0x00400000, 256, 256, 1, 4, 0, 0x20000800, 0x20002000, 0x400e0a00, 0x20000000, 0x20002000, 0, EEFC_TIMING }, // C
+    //
+    // SAM3S
+    //
+    { 0x28800960, "ATSAM3S4", Device::FLASH_EEFC, 0x00400000, 1024, 256, 1, 16, 0, 0x20001000, 0x2000c000, 0x400e0a00, 0x20000000, 0x2000c000, 0, EEFC_TIMING }, // A
+    { 0x28900960, "ATSAM3S4", Device::FLASH_EEFC, 0x00400000, 1024, 256, 1, 16, 0, 0x20001000, 0x2000c000, 0x400e0a00, 0x20000000, 0x2000c000, 0, EEFC_TIMING }, // B
+    { 0x28a00960, "ATSAM3S4", Device::FLASH_EEFC, 0x00400000, 1024, 256, 1, 16, 0, 0x20001000, 0x2000c000, 0x400e0a00, 0x20000000, 0x2000c000, 0, EEFC_TIMING }, // C
+    { 0x288a0760, "ATSAM3S2", Device::FLASH_EEFC, 0x00400000, 512, 256, 1, 8, 0, 0x20000800, 0x20008000, 0x400e0a00, 0x20000000, 0x20008000, 0, EEFC_TIMING }, // A
+    { 0x289a0760, "ATSAM3S2", Device::FLASH_EEFC, 0x00400000, 512, 256, 1, 8, 0, 0x20000800, 0x20008000, 0x400e0a00, 0x20000000, 0x20008000, 0, EEFC_TIMING }, // B
+    { 0x28aa0760, "ATSAM3S2", Device::FLASH_EEFC, 0x00400000, 512, 256, 1, 8, 0, 0x20000800, 0x20008000, 0x400e0a00, 0x20000000, 0x20008000, 0, EEFC_TIMING }, // C
+    { 0x288a0560, "ATSAM3S1", Device::FLASH_EEFC, 0x00400000, 256, 256, 1, 4, 0, 0x20000800, 0x20004000, 0x400e0a00, 0x20000000, 0x20004000, 0, EEFC_TIMING }, // A
+    { 0x289a0560, "ATSAM3S1", Device::FLASH_EEFC, 0x00400000, 256, 256, 1, 4, 0, 0x20000800, 0x20004000, 0x400e0a00, 0x20000000, 0x20004000, 0, EEFC_TIMING }, // B
+    { 0x28aa0560, "ATSAM3S1", Device::FLASH_EEFC, 0x00400000, 256, 256, 1, 4, 0, 0x20000800, 0x20004000, 0x400e0a00, 0x20000000, 0x20004000, 0, EEFC_TIMING }, // C
+    //
+    // SAM3U
+    //
+    { 0x28000960, "ATSAM3U4", Device::FLASH_EEFC, 0x000e0000, 1024, 256, 2, 32, 0, 0x20001000, 0x20008000, 0x400e0800, 0x20000000, 0x20008000, 0, EEFC_TIMING }, // C
+    { 0x28100960, "ATSAM3U4", Device::FLASH_EEFC, 0x000e0000, 1024, 256, 2, 32, 0, 0x20001000, 0x20008000, 0x400e0800, 0x20000000, 0x20008000, 0, EEFC_TIMING }, // E
+    { 0x280a0760, "ATSAM3U2", Device::FLASH_EEFC, 0x00080000, 512, 256, 1, 16, 0, 0x20001000, 0x20004000, 0x400e0800, 0x20000000, 0x20004000, 0, EEFC_TIMING }, // C
+    { 0x281a0760, "ATSAM3U2", Device::FLASH_EEFC, 0x00080000, 512, 256, 1, 16, 0, 0x20001000, 0x20004000, 0x400e0800, 0x20000000, 0x20004000, 0, EEFC_TIMING }, // E
+    { 0x28090560, "ATSAM3U1", Device::FLASH_EEFC, 0x00080000, 256, 256, 1, 8, 0, 0x20001000, 0x20002000, 0x400e0800, 0x20000000, 0x20002000, 0, EEFC_TIMING }, // C
+    { 0x28190560, "ATSAM3U1", Device::FLASH_EEFC, 0x00080000, 256, 256, 1, 8, 0, 0x20001000, 0x20002000, 0x400e0800, 0x20000000, 0x20002000, 0, EEFC_TIMING }, // E
+    //
+    // SAM3X
+    //
+    { 0x286e0a60, "ATSAM3X8", Device::FLASH_EEFC, 0x00080000, 2048, 256, 2, 32, 0, 0x20001000, 0x20010000, 0x400e0a00, 0x20000000, 0x20010000, 0, EEFC_TIMING }, // 8H
+    { 0x285e0a60, "ATSAM3X8", Device::FLASH_EEFC, 0x00080000, 2048, 256, 2, 32, 0, 0x20001000, 0x20010000, 0x400e0a00, 0x20000000, 0x20010000, 0, EEFC_TIMING }, // 8E
+    { 0x284e0a60, "ATSAM3X8", Device::FLASH_EEFC, 0x00080000, 2048, 256, 2, 32, 0, 0x20001000, 0x20010000, 0x400e0a00, 0x20000000, 0x20010000, 0, EEFC_TIMING }, // 8C
+    { 0x285b0960, "ATSAM3X4", Device::FLASH_EEFC, 0x00080000, 1024, 256, 2, 16, 0, 0x20001000, 0x20008000, 0x400e0a00, 0x20000000, 0x20008000, 0, EEFC_TIMING }, // 4E
+    { 0x284b0960, "ATSAM3X4", Device::FLASH_EEFC, 0x00080000, 1024, 256, 2, 16, 0, 0x20001000, 0x20008000, 0x400e0a00, 0x20000000, 0x20008000, 0, EEFC_TIMING }, // 4C
+    //
+    // SAM3A
+    //
+    { 0x283e0a60, "ATSAM3A8", Device::FLASH_EEFC, 0x00080000, 2048, 256, 2, 32, 0, 0x20001000, 0x20010000, 0x400e0a00, 0x20000000, 0x20010000, 0, EEFC_TIMING }, // 8C
+    { 0x283b0960, "ATSAM3A4", Device::FLASH_EEFC, 0x00080000, 1024, 256, 2, 16, 0, 0x20001000, 0x20008000, 0x400e0a00, 0x20000000, 0x20008000, 0, EEFC_TIMING }, // 4C
+    //
+    // SAM7L
+    //
+    { 0x27330740, "ATSAM7L128", Device::FLASH_EEFC, 0x00100000, 512, 256, 1, 16, 0, 0x002ffb40, 0x00300700, 0xffffff60, 0x002ffb40, 0x00300700, 0, EEFC_TIMING },
+    { 0x27330540, "ATSAM7L64", Device::FLASH_EEFC, 0x00100000, 256, 256, 1, 8, 0, 0x002ffb40, 0x00300700, 0xffffff60, 0x002ffb40, 0x00300700, 0, EEFC_TIMING },
+    //
+    // SAM9XE
+    //
+    { 0x329aa3a0, "ATSAM9XE512", Device::FLASH_EEFC, 0x00200000, 1024, 512, 1, 32, 0, 0x00300000, 0x00307000, 0xfffffa00, 0x00300000, 0x00308000, Device::CAN_BROWNOUT, EEFC_TIMING },
+    { 0x329a93a0, "ATSAM9XE256", Device::FLASH_EEFC, 0x00200000, 512, 512, 1, 16, 0, 0x00300000, 0x00307000, 0xfffffa00, 0x00300000, 0x00308000, Device::CAN_BROWNOUT, EEFC_TIMING },
+    { 0x329973a0, "ATSAM9XE128", Device::FLASH_EEFC, 0x00200000, 256, 512, 1, 8, 0, 0x00300000, 0x00303000, 0xfffffa00, 0x00300000, 0x00304000, Device::CAN_BROWNOUT, EEFC_TIMING },
+};
+
+DeviceDb::DeviceDb() : _bits(0)
+{
+    rehash(7);
+
+    for (uint32_t i = 0; i < sizeof(builtinDevices) / sizeof(builtinDevices[0]); i++)
+    {
+        const DeviceEntry& entry = builtinDevices[i];
+        Device device;
+
+        device.chipId = entry.chipId;
+        device.name = entry.name;
+        device.type = entry.type;
+        device.addr = entry.addr;
+        device.pages = entry.pages;
+        device.size = entry.size;
+        device.planes = entry.planes;
+        device.lockRegions = entry.lockRegions;
+        device.reserved = entry.reserved;
+        device.user = entry.user;
+        device.stack = entry.stack;
+        device.regs = entry.regs;
+        device.sramStart = entry.sramStart;
+        device.sramEnd = entry.sramEnd;
+        device.flags = entry.flags;
+        device.pageTimeout = entry.pageTimeout;
+        device.eraseTimeout = entry.eraseTimeout;
+        add(device);
+    }
+}
+
+DeviceDb::~DeviceDb()
+{
+}
+
+uint32_t
+DeviceDb::slot(uint32_t chipId)
+{
+    uint32_t mask = (1 << _bits) - 1;
+    uint32_t index;
+
+    // Fibonacci hashing with linear probing.  The table is kept at most
+    // half full so a probe always ends at the chip ID or an empty slot.
+    index = (chipId * 2654435761U) >> (32 - _bits);
+    while (_slots[index] >= 0 && _devices[_slots[index]].chipId != chipId)
+        index = (index + 1) & mask;
+
+    return index;
+}
+
+void
+DeviceDb::rehash(uint32_t bits)
+{
+    _bits = bits;
+    _slots.assign(1 << bits, -1);
+    for (uint32_t i = 0; i < _devices.size(); i++)
+        _slots[slot(_devices[i].chipId)] = i;
+}
+
+const Device*
+DeviceDb::find(uint32_t chipId)
+{
+    int index = _slots[slot(chipId & DEVICE_ID_MASK)];
+
+    if (index < 0)
+        return NULL;
+
+    return &_devices[index];
+}
+
+void
+DeviceDb::add(const Device& device)
+{
+    Device entry = device;
+    uint32_t index;
+
+    entry.chipId &= DEVICE_ID_MASK;
+
+    // Replace any existing definition of the chip
+    index = slot(entry.chipId);
+    if (_slots[index] >= 0)
+    {
+        _devices[_slots[index]] = entry;
+        return;
+    }
+
+    _devices.push_back(entry);
+    if (_devices.size() * 2 > _slots.size())
+        rehash(_bits + 1);
+    else
+        _slots[index] = _devices.size() - 1;
+}
+
+static uint32_t
+parseFlags(const char* str)
+{
+    uint32_t flags = 0;
+    char buf[64];
+    char* tok;
+
+    if (strcmp(str, "-") == 0)
+        return 0;
+
+    strncpy(buf, str, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    for (tok = strtok(buf, ","); tok; tok = strtok(NULL, ","))
+    {
+        if (strcmp(tok, "bootflash") == 0)
+            flags |= Device::CAN_BOOTFLASH;
+        else if (strcmp(tok, "brownout") == 0)
+            flags |= Device::CAN_BROWNOUT;
+        else if (strcmp(tok, "userpage") == 0)
+            flags |= Device::HAS_USERPAGE;
+        else
+            throw DeviceFileError();
+    }
+
+    return flags;
+}
+
+static uint32_t
+parseNumber(const char* str)
+{
+    char* end;
+    uint32_t value;
+
+    value = strtoul(str, &end, 0);
+    if (*end != '\0')
+        throw DeviceFileError();
+
+    return value;
+}
+
+void
+DeviceDb::load(const std::string& filename)
+{
+    FILE* infile;
+    char line[512];
+    const char* tokv[17];
+    int tokc;
+    char* tok;
+    Device device;
+    std::vector<Device> devices;
+
+    infile = fopen(filename.c_str(), "r");
+    if (!infile)
+        throw DeviceFileError();
+
+    try
+    {
+        // One device per line, '#' starts a comment:
+        // chipid name type addr pages size planes locks reserved user
+        //     stack regs sram_start sram_end flags page_ms erase_ms
+        while (fgets(line, sizeof(line), infile))
+        {
+            char* comment = strchr(line, '#');
+            if (comment)
+                *comment = '\0';
+
+            tokc = 0;
+            for (tok = strtok(line, " \t\r\n"); tok; tok = strtok(NULL, " \t\r\n"))
+            {
+                if (tokc == sizeof(tokv) / sizeof(tokv[0]))
+                    throw DeviceFileError();
+                tokv[tokc++] = tok;
+            }
+            if (tokc == 0)
+                continue;
+            if (tokc != sizeof(tokv) / sizeof(tokv[0]))
+                throw DeviceFileError();
+
+            device.chipId = parseNumber(tokv[0]);
+            device.name = tokv[1];
+            if (strcmp(tokv[2], "efc") == 0)
+                device.type = Device::FLASH_EFC;
+            else if (strcmp(tokv[2], "eefc") == 0)
+                device.type = Device::FLASH_EEFC;
+            else if (strcmp(tokv[2], "calw") == 0)
+                device.type = Device::FLASH_CALW;
+            else
+                throw DeviceFileError();
+            device.addr = parseNumber(tokv[3]);
+            device.pages = parseNumber(tokv[4]);
+            device.size = parseNumber(tokv[5]);
+            device.planes = parseNumber(tokv[6]);
+            device.lockRegions = parseNumber(tokv[7]);
+            device.reserved = parseNumber(tokv[8]);
+            device.user = parseNumber(tokv[9]);
+            device.stack = parseNumber(tokv[10]);
+            device.regs = parseNumber(tokv[11]);
+            device.sramStart = parseNumber(tokv[12]);
+            device.sramEnd = parseNumber(tokv[13]);
+            device.flags = parseFlags(tokv[14]);
+            device.pageTimeout = parseNumber(tokv[15]);
+            device.eraseTimeout = parseNumber(tokv[16]);
+
+            if (device.planes < 1 || device.planes > 2 ||
+                device.lockRegions == 0 || device.lockRegions % device.planes ||
+                device.pages == 0 || device.size == 0)
+                throw DeviceFileError();
+
+            devices.push_back(device);
+        }
+    }
+    catch(...)
+    {
+        fclose(infile);
+        throw;
+    }
+    fclose(infile);
+
+    // Nothing is added unless the whole file is valid
+    for (uint32_t i = 0; i < devices.size(); i++)
+        add(devices[i]);
+}
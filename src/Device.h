@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef _DEVICE_H
+#define _DEVICE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <exception>
+
+// Chip ID bits that identify a device (the low bits are the revision)
+#define DEVICE_ID_MASK 0x7fffffe0
+
+class DeviceFileError : public std::exception
+{
+public:
+    DeviceFileError() : exception() {};
+    const char* what() const throw() { return "Invalid device file"; }
+};
+
+class Device
+{
+public:
+    enum FlashType
+    {
+        FLASH_EFC,
+        FLASH_EEFC,
+        FLASH_CALW,
+    };
+
+    enum
+    {
+        CAN_BOOTFLASH = (1 << 0),
+        CAN_BROWNOUT  = (1 << 1),
+        HAS_USERPAGE  = (1 << 2),
+    };
+
+    uint32_t chipId;        // Masked with DEVICE_ID_MASK
+    std::string name;
+    FlashType type;
+    uint32_t addr;          // Flash base address
+    uint32_t pages;
+    uint32_t size;          // Page size in bytes
+    uint32_t planes;
+    uint32_t lockRegions;
+    uint32_t reserved;      // Bytes of flash reserved for the bootloader
+    uint32_t user;          // First SRAM address free for applets
+    uint32_t stack;         // Applet stack top
+    uint32_t regs;          // Flash controller registers
+    uint32_t sramStart;
+    uint32_t sramEnd;
+    uint32_t flags;
+    uint32_t pageTimeout;   // Worst case page erase and write in ms
+    uint32_t eraseTimeout;  // Worst case full erase in ms
+};
+
+class DeviceDb
+{
+public:
+    DeviceDb();
+    virtual ~DeviceDb();
+
+    const Device* find(uint32_t chipId);
+
+    void add(const Device& device);
+    void load(const std::string& filename);
+
+    uint32_t count() { return _devices.size(); }
+
+private:
+    std::vector<Device> _devices;
+    std::vector<int> _slots;
+    uint32_t _bits;
+
+    void rehash(uint32_t bits);
+    uint32_t slot(uint32_t chipId);
+};
+
+#endif // _DEVICE_H
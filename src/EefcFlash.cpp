@@ -19,7 +19,6 @@
 #include "EefcFlash.h"
 
 #include <assert.h>
-#include <unistd.h>
 #include <stdio.h>
 
 #define EEFC_KEY        0x5a
@@ -59,11 +58,12 @@ EefcFlash::EefcFlash(Samba& samba,
                      uint32_t regs,
                      bool canBrownout)
     : Flash(samba, name, addr, pages, size, planes, lockRegions, user, stack),
-      _regs(regs), _canBrownout(canBrownout), _eraseAuto(true)
+      _regs(regs), _canBrownout(canBrownout), _eraseAuto(true),
+      _gpnvmValid(false), _gpnvm(0)
 {
     assert(planes == 1 || planes == 2);
-    assert(pages <= 1024);
-    assert(lockRegions <= 32);
+    assert(pages <= 2048);
+    assert(lockRegions <= 128);
 
     // SAM3 Errata (FWS must be 6)
     _samba.writeWord(EEFC0_FMR, 0x6 << 8);
@@ -78,11 +78,11 @@ EefcFlash::~EefcFlash()
 void
 EefcFlash::eraseAll()
 {
-    waitFSR();
+    waitReady();
     writeFCR0(EEFC_FCMD_EA, 0);
     if (_planes == 2)
     {
-        waitFSR();
+        waitReady();
         writeFCR1(EEFC_FCMD_EA, 0);
     }
 }
@@ -96,16 +96,12 @@ EefcFlash::eraseAuto(bool enable)
 bool
 EefcFlash::isLocked()
 {
-    waitFSR();
-    writeFCR0(EEFC_FCMD_GLB, 0);
-    waitFSR();
-    if (readFRR0())
-        return true;
-    if (_planes == 2)
+    std::vector<bool> regions;
+
+    getLockRegions(regions);
+    for (uint32_t region = 0; region < _lockRegions; region++)
     {
-        writeFCR1(EEFC_FCMD_GLB, 0);
-        waitFSR();
-        if (readFRR1())
+        if (regions[region])
             return true;
     }
 
@@ -115,67 +111,108 @@ EefcFlash::isLocked()
 bool
 EefcFlash::getLockRegion(uint32_t region)
 {
+    std::vector<bool> regions;
+
     if (region >= _lockRegions)
         throw FlashRegionError();
 
-    waitFSR();
-    if (_planes == 2 && region >= _lockRegions / 2)
+    getLockRegions(regions);
+    return regions[region];
+}
+
+void
+EefcFlash::getLockRegions(std::vector<bool>& regions)
+{
+    uint32_t planeRegions = _lockRegions / _planes;
+    uint32_t frr = 0;
+
+    regions.resize(_lockRegions);
+
+    // GLB returns one FRR word for every 32 lock regions of the plane
+    waitReady();
+    writeFCR0(EEFC_FCMD_GLB, 0);
+    waitReady();
+    for (uint32_t region = 0; region < planeRegions; region++)
     {
-        writeFCR1(EEFC_FCMD_GLB, 0);
-        waitFSR();
-        if (readFRR1() & (1 << (region - _lockRegions / 2)))
-            return true;
+        if (region % 32 == 0)
+            frr = readFRR0();
+        regions[region] = frr & (1 << (region % 32));
     }
-    else
+
+    if (_planes == 2)
     {
-        writeFCR0(EEFC_FCMD_GLB, 0);
-        waitFSR();
-        if (readFRR0() & (1 << region))
-            return true;
+        writeFCR1(EEFC_FCMD_GLB, 0);
+        waitReady();
+        for (uint32_t region = 0; region < planeRegions; region++)
+        {
+            if (region % 32 == 0)
+                frr = readFRR1();
+            regions[planeRegions + region] = frr & (1 << (region % 32));
+        }
     }
-
-    return false;
 }
 
 void
-EefcFlash::setLockRegion(uint32_t region, bool enable)
+EefcFlash::writeLockRegion(uint32_t region, bool enable)
 {
     uint32_t page;
 
-    if (region >= _lockRegions)
-        throw FlashRegionError();
+    if (_planes == 2 && region >= _lockRegions / 2)
+    {
+        page = (region - _lockRegions / 2) * _pages / _lockRegions;
+        waitReady();
+        writeFCR1(enable ? EEFC_FCMD_SLB : EEFC_FCMD_CLB, page);
+    }
+    else
+    {
+        page = region * _pages / _lockRegions;
+        waitReady();
+        writeFCR0(enable ? EEFC_FCMD_SLB : EEFC_FCMD_CLB, page);
+    }
+}
 
-    if (enable != getLockRegion(region))
+uint32_t
+EefcFlash::getGpnvm()
+{
+    // The GPNVM bits only change through the commands issued below so
+    // they are read once and kept in sync afterwards
+    if (!_gpnvmValid)
     {
-        if (_planes == 2 && region >= _lockRegions / 2)
-        {
-            page = (region - _lockRegions / 2) * _pages / _lockRegions;
-            waitFSR();
-            writeFCR1(enable ? EEFC_FCMD_SLB : EEFC_FCMD_CLB, page);
-        }
-        else
-        {
-            page = region * _pages / _lockRegions;
-            waitFSR();
-            writeFCR0(enable ? EEFC_FCMD_SLB : EEFC_FCMD_CLB, page);
-        }
+        waitReady();
+        writeFCR0(EEFC_FCMD_GGPB, 0);
+        waitReady();
+        _gpnvm = readFRR0();
+        _gpnvmValid = true;
     }
+
+    return _gpnvm;
+}
+
+void
+EefcFlash::setGpnvm(uint32_t bit, bool enable)
+{
+    if (((getGpnvm() & (1 << bit)) != 0) == enable)
+        return;
+
+    waitReady();
+    writeFCR0(enable ? EEFC_FCMD_SGPB : EEFC_FCMD_CGPB, bit);
+
+    if (enable)
+        _gpnvm |= (1 << bit);
+    else
+        _gpnvm &= ~(1 << bit);
 }
 
 bool
 EefcFlash::getSecurity()
 {
-    waitFSR();
-    writeFCR0(EEFC_FCMD_GGPB, 0);
-    waitFSR();
-    return (readFRR0() & (1 << 0));
+    return (getGpnvm() & (1 << 0));
 }
 
 void
 EefcFlash::setSecurity()
 {
-    waitFSR();
-    writeFCR0(EEFC_FCMD_SGPB, 0);
+    setGpnvm(0, true);
 }
 
 bool
@@ -184,10 +221,7 @@ EefcFlash::getBod()
     if (!_canBrownout)
         return false;
 
-    waitFSR();
-    writeFCR0(EEFC_FCMD_GGPB, 0);
-    waitFSR();
-    return (readFRR0() & (1 << 1));
+    return (getGpnvm() & (1 << 1));
 }
 
 void
@@ -196,8 +230,7 @@ EefcFlash::setBod(bool enable)
     if (!_canBrownout)
         return;
 
-    waitFSR();
-    writeFCR0(enable ? EEFC_FCMD_SGPB : EEFC_FCMD_CGPB, 1);
+    setGpnvm(1, enable);
 }
 
 bool
@@ -206,10 +239,7 @@ EefcFlash::getBor()
     if (!_canBrownout)
         return false;
 
-    waitFSR();
-    writeFCR0(EEFC_FCMD_GGPB, 0);
-    waitFSR();
-    return (readFRR0() & (1 << 2));
+    return (getGpnvm() & (1 << 2));
 }
 
 void
@@ -218,24 +248,19 @@ EefcFlash::setBor(bool enable)
     if (!_canBrownout)
         return;
 
-    waitFSR();
-    writeFCR0(enable ? EEFC_FCMD_SGPB : EEFC_FCMD_CGPB, 2);
+    setGpnvm(2, enable);
 }
 
 bool
 EefcFlash::getBootFlash()
 {
-    waitFSR();
-    writeFCR0(EEFC_FCMD_GGPB, 0);
-    waitFSR();
-    return (readFRR0() & (1 << (_canBrownout ? 3 : 1)));
+    return (getGpnvm() & (1 << (_canBrownout ? 3 : 1)));
 }
 
 void
 EefcFlash::setBootFlash(bool enable)
 {
-    waitFSR();
-    writeFCR0(enable ? EEFC_FCMD_SGPB : EEFC_FCMD_CGPB, (_canBrownout ? 3 : 1));
+    setGpnvm(_canBrownout ? 3 : 1, enable);
 }
 
 void
@@ -244,11 +269,11 @@ EefcFlash::writePage(uint32_t page)
     if (page >= _pages)
         throw FlashPageError();
 
-    _wordCopy.setDstAddr(_addr + page * _size);
-    _wordCopy.setSrcAddr(_onBufferA ? _pageBufferA : _pageBufferB);
-    _onBufferA = !_onBufferA;
-    waitFSR();
-    _wordCopy.runv();
+    _wordCopy->setDstAddr(_addr + page * _size);
+    _wordCopy->setSrcAddr(pageBuffer());
+    nextBuffer();
+    waitReady();
+    _wordCopy->runv();
     if (_planes == 2 && page >= _pages / 2)
         writeFCR1(_eraseAuto ? EEFC_FCMD_EWP : EEFC_FCMD_WP, page - _pages / 2);
     else
@@ -258,55 +283,80 @@ EefcFlash::writePage(uint32_t page)
 void
 EefcFlash::readPage(uint32_t page, uint8_t* data)
 {
-    if (page >= _pages)
+    readPages(page, data, 1);
+}
+
+void
+EefcFlash::readPages(uint32_t page, uint8_t* data, uint32_t numPages)
+{
+    if (page + numPages > _pages)
         throw FlashPageError();
 
     // The SAM3 firmware has a bug where it returns all zeros for reads
-    // directly from the flash so instead, we copy the flash page to
-    // SRAM and read it from there.
-    _wordCopy.setDstAddr(_onBufferA ? _pageBufferA : _pageBufferB);
-    _wordCopy.setSrcAddr(_addr + page * _size);
-    waitFSR();
-    _wordCopy.runv();
-    _samba.read(_onBufferA ? _pageBufferA : _pageBufferB, data, _size);
+    // directly from the flash.  readFlash() detects this and copies the
+    // flash to SRAM first when needed.
+    waitReady();
+    readFlash(page, data, numPages);
 }
 
 void
-EefcFlash::waitFSR()
+EefcFlash::runApplet(Applet& applet)
+{
+    waitReady();
+    applet.runv();
+}
+
+bool
+EefcFlash::pollReady()
 {
-    uint32_t tries = 0;
     uint32_t fsr0;
     uint32_t fsr1 = 0x1;
 
-    while (++tries <= 500)
-    {
-        fsr0 = _samba.readWord(EEFC0_FSR);
-        if (fsr0 & (1 << 2))
-            throw FlashLockError();
+    // FRR is only read once FSR shows the command done since each read
+    // of it takes the next word of a command's result
+    fsr0 = _samba.readWord(EEFC0_FSR);
+    if (_planes == 2)
+        fsr1 = _samba.readWord(EEFC1_FSR);
 
-        if (_planes == 2)
-        {
-            fsr1 = _samba.readWord(EEFC1_FSR);
-            if (fsr1 & (1 << 2))
-                throw FlashLockError();
-        }
-        if (fsr0 & fsr1 & 0x1)
-            break;
-        usleep(100);
+    if ((fsr0 | fsr1) & (1 << 2))
+        throw FlashLockError();
+    return fsr0 & fsr1 & 0x1;
+}
+
+Flash::FlashOp
+EefcFlash::commandOp(uint8_t cmd)
+{
+    switch (cmd)
+    {
+    case EEFC_FCMD_WP:
+    case EEFC_FCMD_WPL:
+        return OP_WRITE;
+    case EEFC_FCMD_EWP:
+    case EEFC_FCMD_EWPL:
+        return OP_ERASE_WRITE;
+    case EEFC_FCMD_EA:
+        return OP_ERASE_ALL;
+    case EEFC_FCMD_SLB:
+    case EEFC_FCMD_CLB:
+    case EEFC_FCMD_SGPB:
+    case EEFC_FCMD_CGPB:
+        return OP_LOCK;
+    default:
+        return OP_OTHER;
     }
-    if (tries > 500)
-        throw FlashCmdError();
 }
 
 void
 EefcFlash::writeFCR0(uint8_t cmd, uint32_t arg)
 {
+    startOp(commandOp(cmd));
     _samba.writeWord(EEFC0_FCR, (EEFC_KEY << 24) | (arg << 8) | cmd);
 }
 
 void
 EefcFlash::writeFCR1(uint8_t cmd, uint32_t arg)
 {
+    startOp(commandOp(cmd));
     _samba.writeWord(EEFC1_FCR, (EEFC_KEY << 24) | (arg << 8) | cmd);
 }
 
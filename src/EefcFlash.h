@@ -45,7 +45,7 @@ public:
 
     bool isLocked();
     bool getLockRegion(uint32_t region);
-    void setLockRegion(uint32_t region, bool enable);
+    void getLockRegions(std::vector<bool>& regions);
 
     bool getSecurity();
     void setSecurity();
@@ -64,13 +64,24 @@ public:
 
     void writePage(uint32_t page);
     void readPage(uint32_t page, uint8_t* data);
+    void readPages(uint32_t page, uint8_t* data, uint32_t numPages);
+
+protected:
+    void writeLockRegion(uint32_t region, bool enable);
+    void runApplet(Applet& applet);
+    bool pollReady();
 
 private:
     uint32_t _regs;
     bool _canBrownout;
     bool _eraseAuto;
+    bool _gpnvmValid;
+    uint32_t _gpnvm;
+
+    uint32_t getGpnvm();
+    void setGpnvm(uint32_t bit, bool enable);
 
-    void waitFSR();
+    FlashOp commandOp(uint8_t cmd);
     void writeFCR0(uint8_t cmd, uint32_t arg);
     void writeFCR1(uint8_t cmd, uint32_t arg);
     uint32_t readFRR0();
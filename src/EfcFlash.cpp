@@ -19,7 +19,6 @@
 #include "EfcFlash.h"
 
 #include <assert.h>
-#include <unistd.h>
 #include <stdio.h>
 
 #define EFC_KEY         0x5a
@@ -52,7 +51,7 @@ EfcFlash::EfcFlash(Samba& samba,
                    uint32_t stack,
                    bool canBootFlash)
     : Flash(samba, name, addr, pages, size, planes, lockRegions, user, stack),
-      _canBootFlash(canBootFlash)
+      _canBootFlash(canBootFlash), _eraseAuto(true)
 {
     assert(planes == 1 || planes == 2);
     assert(pages <= planes * 1024);
@@ -68,11 +67,11 @@ EfcFlash::~EfcFlash()
 void
 EfcFlash::eraseAll()
 {
-    waitFSR();
+    waitReady();
     writeFCR0(EFC_FCMD_EA, 0);
     if (_planes == 2)
     {
-        waitFSR();
+        waitReady();
         writeFCR0(EFC_FCMD_EA, _pages / 2);
     }
 }
@@ -82,7 +81,8 @@ EfcFlash::eraseAuto(bool enable)
 {
     uint32_t fmr;
 
-    waitFSR();
+    _eraseAuto = enable;
+    waitReady();
     fmr = _samba.readWord(EFC0_FMR);
     if (enable)
         fmr &= ~(1 << 7);
@@ -92,7 +92,7 @@ EfcFlash::eraseAuto(bool enable)
     _samba.writeWord(EFC0_FMR, fmr);
     if (_planes == 2)
     {
-        waitFSR();
+        waitReady();
         _samba.writeWord(EFC1_FMR, fmr);
     }
 }
@@ -123,27 +123,42 @@ EfcFlash::getLockRegion(uint32_t region)
 }
 
 void
-EfcFlash::setLockRegion(uint32_t region, bool enable)
+EfcFlash::getLockRegions(std::vector<bool>& regions)
 {
-    uint32_t page;
+    uint32_t planeRegions = _lockRegions / _planes;
+    uint32_t fsr;
 
-    if (region >= _lockRegions)
-        throw FlashRegionError();
+    regions.resize(_lockRegions);
+
+    // The lock bits of each plane are all held in its FSR
+    fsr = readFSR0();
+    for (uint32_t region = 0; region < planeRegions; region++)
+        regions[region] = fsr & (1 << (16 + region));
+
+    if (_planes == 2)
+    {
+        fsr = readFSR1();
+        for (uint32_t region = 0; region < planeRegions; region++)
+            regions[planeRegions + region] = fsr & (1 << (16 + region));
+    }
+}
+
+void
+EfcFlash::writeLockRegion(uint32_t region, bool enable)
+{
+    uint32_t page;
 
-    if (enable != getLockRegion(region))
+    if (_planes == 2 && region >= _lockRegions / 2)
+    {
+        page = (region - _lockRegions / 2) * _pages / _lockRegions;
+        waitReady();
+        writeFCR1(enable ? EFC_FCMD_SLB : EFC_FCMD_CLB, page);
+    }
+    else
     {
-        if (_planes == 2 && region >= _lockRegions / 2)
-        {
-            page = (region - _lockRegions / 2) * _pages / _lockRegions;
-            waitFSR();
-            writeFCR1(enable ? EFC_FCMD_SLB : EFC_FCMD_CLB, page);
-        }
-        else
-        {
-            page = region * _pages / _lockRegions;
-            waitFSR();
-            writeFCR0(enable ? EFC_FCMD_SLB : EFC_FCMD_CLB, page);
-        }
+        page = region * _pages / _lockRegions;
+        waitReady();
+        writeFCR0(enable ? EFC_FCMD_SLB : EFC_FCMD_CLB, page);
     }
 }
 
@@ -156,7 +171,10 @@ EfcFlash::getSecurity()
 void
 EfcFlash::setSecurity()
 {
-    waitFSR();
+    if (getSecurity())
+        return;
+
+    waitReady();
     writeFCR0(EFC_FCMD_SSB, 0);
 }
 
@@ -169,7 +187,10 @@ EfcFlash::getBod()
 void
 EfcFlash::setBod(bool enable)
 {
-    waitFSR();
+    if (getBod() == enable)
+        return;
+
+    waitReady();
     writeFCR0(enable ? EFC_FCMD_SGPB : EFC_FCMD_CGPB, 0);
 }
 
@@ -182,7 +203,10 @@ EfcFlash::getBor()
 void
 EfcFlash::setBor(bool enable)
 {
-    waitFSR();
+    if (getBor() == enable)
+        return;
+
+    waitReady();
     writeFCR0(enable ? EFC_FCMD_SGPB : EFC_FCMD_CGPB, 1);
 }
 
@@ -198,10 +222,10 @@ EfcFlash::getBootFlash()
 void
 EfcFlash::setBootFlash(bool enable)
 {
-    if (!_canBootFlash)
+    if (!_canBootFlash || getBootFlash() == enable)
         return;
 
-    waitFSR();
+    waitReady();
     writeFCR0(enable ? EFC_FCMD_SGPB : EFC_FCMD_CGPB, 2);
 }
 
@@ -211,11 +235,11 @@ EfcFlash::writePage(uint32_t page)
     if (page >= _pages)
         throw FlashPageError();
 
-    _wordCopy.setDstAddr(_addr + page * _size);
-    _wordCopy.setSrcAddr(_onBufferA ? _pageBufferA : _pageBufferB);
-    _onBufferA = !_onBufferA;
-    waitFSR();
-    _wordCopy.run();
+    _wordCopy->setDstAddr(_addr + page * _size);
+    _wordCopy->setSrcAddr(pageBuffer());
+    nextBuffer();
+    waitReady();
+    _wordCopy->run();
     if (_planes == 2 && page >= _pages / 2)
         writeFCR1(EFC_FCMD_WP, page - _pages / 2);
     else
@@ -225,49 +249,85 @@ EfcFlash::writePage(uint32_t page)
 void
 EfcFlash::readPage(uint32_t page, uint8_t* data)
 {
-    if (page >= _pages)
+    readPages(page, data, 1);
+}
+
+void
+EfcFlash::readPages(uint32_t page, uint8_t* data, uint32_t numPages)
+{
+    if (page + numPages > _pages)
         throw FlashPageError();
 
-    waitFSR();
-    _samba.read(_addr + page * _size, data, _size);
+    waitReady();
+    _samba.read(_addr + page * _size, data, numPages * _size);
 }
 
 void
-EfcFlash::waitFSR()
+EfcFlash::runApplet(Applet& applet)
+{
+    waitReady();
+    applet.run();
+}
+
+bool
+EfcFlash::pollReady()
 {
-    uint32_t tries = 0;
+    uint8_t window[EFC1_FSR - EFC0_FSR + sizeof(uint32_t)];
     uint32_t fsr0;
     uint32_t fsr1 = 0x1;
 
-    while (++tries <= 500)
+    // The registers of both planes are contiguous so over USB their
+    // status comes back in one block read.  XMODEM makes a block read
+    // cost more than two word reads on a UART.
+    if (_planes == 2 && _samba.isUsb())
+    {
+        _samba.read(EFC0_FSR, window, sizeof(window));
+        fsr0 = (window[3] << 24 | window[2] << 16 | window[1] << 8 | window[0]);
+        fsr1 = (window[19] << 24 | window[18] << 16 | window[17] << 8 | window[16]);
+    }
+    else
     {
         fsr0 = readFSR0();
-        if (fsr0 & (1 << 2))
-            throw FlashLockError();
-
         if (_planes == 2)
-        {
             fsr1 = readFSR1();
-            if (fsr1 & (1 << 2))
-                throw FlashLockError();
-        }
-        if (fsr0 & fsr1 & 0x1)
-            break;
-        usleep(100);
     }
-    if (tries > 500)
-        throw FlashCmdError();
+
+    if ((fsr0 | fsr1) & (1 << 2))
+        throw FlashLockError();
+    return fsr0 & fsr1 & 0x1;
+}
+
+Flash::FlashOp
+EfcFlash::commandOp(uint8_t cmd)
+{
+    switch (cmd)
+    {
+    case EFC_FCMD_WP:
+    case EFC_FCMD_WPL:
+        return _eraseAuto ? OP_ERASE_WRITE : OP_WRITE;
+    case EFC_FCMD_EA:
+        return OP_ERASE_ALL;
+    case EFC_FCMD_SLB:
+    case EFC_FCMD_CLB:
+    case EFC_FCMD_SGPB:
+    case EFC_FCMD_CGPB:
+        return OP_LOCK;
+    default:
+        return OP_OTHER;
+    }
 }
 
 void
 EfcFlash::writeFCR0(uint8_t cmd, uint32_t arg)
 {
+    startOp(commandOp(cmd));
     _samba.writeWord(EFC0_FCR, (EFC_KEY << 24) | (arg << 8) | cmd);
 }
 
 void
 EfcFlash::writeFCR1(uint8_t cmd, uint32_t arg)
 {
+    startOp(commandOp(cmd));
     _samba.writeWord(EFC1_FCR, (EFC_KEY << 24) | (arg << 8) | cmd);
 }
 
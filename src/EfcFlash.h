@@ -44,7 +44,7 @@ public:
 
     bool isLocked();
     bool getLockRegion(uint32_t region);
-    void setLockRegion(uint32_t region, bool enable);
+    void getLockRegions(std::vector<bool>& regions);
 
     bool getSecurity();
     void setSecurity();
@@ -63,11 +63,18 @@ public:
 
     void writePage(uint32_t page);
     void readPage(uint32_t page, uint8_t* data);
+    void readPages(uint32_t page, uint8_t* data, uint32_t numPages);
+
+protected:
+    void writeLockRegion(uint32_t region, bool enable);
+    void runApplet(Applet& applet);
+    bool pollReady();
 
 private:
     bool _canBootFlash;
+    bool _eraseAuto;
 
-    void waitFSR();
+    FlashOp commandOp(uint8_t cmd);
     void writeFCR0(uint8_t cmd, uint32_t arg);
     void writeFCR1(uint8_t cmd, uint32_t arg);
     uint32_t readFSR0();
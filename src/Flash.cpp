@@ -17,8 +17,32 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ///////////////////////////////////////////////////////////////////////////////
 #include "Flash.h"
+#include "BlankCheckApplet.h"
 
 #include <assert.h>
+#include <string.h>
+#include <unistd.h>
+
+// Upper bound on the SRAM page buffer ring in bytes
+#define FLASH_BUFFER_MAX    (32 * 1024)
+
+// Default worst case command times in ms for devices that do not give any
+#define FLASH_PAGE_TIMEOUT  20
+#define FLASH_ERASE_TIMEOUT 10000
+// Poll interval bounds in us once the expected completion time has passed
+#define FLASH_POLL_MIN      100
+#define FLASH_POLL_MAX      10000
+// Slack in us added to twice the worst case before a command is failed
+#define FLASH_POLL_MARGIN   100000
+
+static uint32_t
+elapsedUs(const struct timeval& start)
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    return (now.tv_sec - start.tv_sec) * 1000000 + now.tv_usec - start.tv_usec;
+}
 
 Flash::Flash(Samba& samba,
              const std::string& name,
@@ -30,36 +54,302 @@ Flash::Flash(Samba& samba,
              uint32_t user,
              uint32_t stack)
     : _samba(samba), _name(name), _addr(addr), _pages(pages), _size(size),
-      _planes(planes), _lockRegions(lockRegions), _user(user), _wordCopy(samba, user)
+      _planes(planes), _lockRegions(lockRegions), _user(user), _stack(stack),
+      _wordCopy(CopyApplet::create(samba, user)), _directProbed(false), _directRead(false),
+      _op(-1)
 {
     assert((size & (size - 1)) == 0);
     assert((pages & (pages - 1)) == 0);
     assert((lockRegions & (lockRegions - 1)) == 0);
 
-    _wordCopy.setWords(size / sizeof(uint32_t));
-    _wordCopy.setStack(stack);
+    _wordCopy->setWords(size / sizeof(uint32_t));
+    _wordCopy->setStack(stack);
 
-    _onBufferA = true;
-    _pageBufferA = _user + _wordCopy.size();
-    _pageBufferB = _pageBufferA + size;
+    setBuffers(_user + _wordCopy->size());
+    setTimeouts(FLASH_PAGE_TIMEOUT, FLASH_ERASE_TIMEOUT);
 }
 
 void
-Flash::lockAll()
+Flash::setBuffers(uint32_t start)
 {
+    uint32_t end;
+
+    // Use the SRAM between the applets and the stack as a ring of page
+    // buffers so many pages can be moved with a single transfer.  The
+    // monitor's own stack also grows down from the top of SRAM while the
+    // ring is written and how deep it goes is not documented, so the ring
+    // only takes the lower half of the gap.
+    end = start + (_stack - start) / 2;
+    if (end > start + FLASH_BUFFER_MAX)
+        end = start + FLASH_BUFFER_MAX;
+    _bufferAddr = start;
+    _bufferPages = end > start ? (end - start) / _size : 0;
+    _bufferSlot = 0;
+
+    assert(_bufferPages >= 2);
+}
+
+void
+Flash::setLockRegion(uint32_t region, bool enable)
+{
+    if (region >= _lockRegions)
+        throw FlashRegionError();
+
+    if (enable != getLockRegion(region))
+        writeLockRegion(region, enable);
+}
+
+void
+Flash::getLockRegions(std::vector<bool>& regions)
+{
+    regions.resize(_lockRegions);
     for (uint32_t region = 0; region < _lockRegions; region++)
-        setLockRegion(region, true);
+        regions[region] = getLockRegion(region);
 }
 
 void
-Flash::unlockAll()
+Flash::setLockRegions(const std::vector<bool>& regions)
 {
+    std::vector<bool> current;
+
+    if (regions.size() != _lockRegions)
+        throw FlashRegionError();
+
+    // Take one snapshot of the lock bits and only issue commands
+    // for the regions that actually change
+    getLockRegions(current);
     for (uint32_t region = 0; region < _lockRegions; region++)
-        setLockRegion(region, false);
+    {
+        if (regions[region] != current[region])
+            writeLockRegion(region, regions[region]);
+    }
+}
+
+void
+Flash::lockAll()
+{
+    setLockRegions(std::vector<bool>(_lockRegions, true));
+}
+
+void
+Flash::unlockAll()
+{
+    setLockRegions(std::vector<bool>(_lockRegions, false));
 }
 
 void
 Flash::loadBuffer(const uint8_t* data)
 {
-    _samba.write(_onBufferA ? _pageBufferA : _pageBufferB, data, _size);
+    _samba.write(pageBuffer(), data, _size);
+}
+
+void
+Flash::writePages(uint32_t page, const uint8_t* data, uint32_t numPages)
+{
+    uint32_t batch;
+
+    // Fill the whole ring with one transfer and then program each
+    // slot in order
+    while (numPages > 0)
+    {
+        batch = numPages < _bufferPages ? numPages : _bufferPages;
+        _bufferSlot = 0;
+        _samba.write(_bufferAddr, data, batch * _size);
+        for (uint32_t i = 0; i < batch; i++)
+            writePage(page + i);
+
+        page += batch;
+        data += batch * _size;
+        numPages -= batch;
+    }
+}
+
+void
+Flash::readPages(uint32_t page, uint8_t* data, uint32_t numPages)
+{
+    while (numPages-- > 0)
+    {
+        readPage(page++, data);
+        data += _size;
+    }
+}
+
+bool
+Flash::canReadDirect()
+{
+    uint8_t direct[64];
+    uint8_t words[sizeof(direct)];
+    bool blank = true;
+
+    if (_directProbed)
+        return _directRead;
+
+    // Some SAM-BA monitors return zeros for non-word reads from the
+    // flash.  Compare a block read against word reads of the same
+    // flash; if the flash reads as zero the probe is inconclusive and
+    // the slower copy through SRAM is used.
+    _samba.read(_addr, direct, sizeof(direct));
+    for (uint32_t i = 0; i < sizeof(words); i += sizeof(uint32_t))
+    {
+        uint32_t word = _samba.readWord(_addr + i);
+        words[i + 0] = word;
+        words[i + 1] = word >> 8;
+        words[i + 2] = word >> 16;
+        words[i + 3] = word >> 24;
+        if (word)
+            blank = false;
+    }
+
+    _directRead = !blank && memcmp(direct, words, sizeof(direct)) == 0;
+    _directProbed = true;
+
+    return _directRead;
+}
+
+void
+Flash::readFlash(uint32_t page, uint8_t* data, uint32_t numPages)
+{
+    uint32_t batch;
+
+    if (canReadDirect())
+    {
+        _samba.read(_addr + page * _size, data, numPages * _size);
+        return;
+    }
+
+    // Copy as many pages as fit in the ring to SRAM per applet run
+    while (numPages > 0)
+    {
+        batch = numPages < _bufferPages ? numPages : _bufferPages;
+        _wordCopy->setDstAddr(_bufferAddr);
+        _wordCopy->setSrcAddr(_addr + page * _size);
+        _wordCopy->setWords(batch * _size / sizeof(uint32_t));
+        _wordCopy->runv();
+        _samba.read(_bufferAddr, data, batch * _size);
+
+        page += batch;
+        data += batch * _size;
+        numPages -= batch;
+    }
+    _wordCopy->setWords(_size / sizeof(uint32_t));
+}
+
+void
+Flash::checkBlank(uint32_t page, uint32_t numPages, std::vector<bool>& dirty)
+{
+    uint32_t bitmapAddr;
+    uint32_t bitmapSize = (numPages + 31) / 32 * sizeof(uint32_t);
+    std::vector<uint8_t> bitmap(bitmapSize);
+
+    if (page + numPages > _pages)
+        throw FlashPageError();
+
+    // The applet and its bitmap borrow the page buffer ring so it is
+    // loaded again for each check
+    BlankCheckApplet blankCheck(_samba, _bufferAddr);
+    bitmapAddr = blankCheck.addr() + blankCheck.size();
+    assert(bitmapAddr + bitmapSize <= _bufferAddr + _bufferPages * _size);
+
+    blankCheck.setStack(_stack);
+    blankCheck.setSrcAddr(_addr + page * _size);
+    blankCheck.setDstAddr(bitmapAddr);
+    blankCheck.setWords(_size / sizeof(uint32_t));
+    blankCheck.setPages(numPages);
+
+    runApplet(blankCheck);
+    _samba.read(bitmapAddr, &bitmap[0], bitmapSize);
+
+    dirty.resize(numPages);
+    for (uint32_t i = 0; i < numPages; i++)
+        dirty[i] = bitmap[i / 8] & (1 << (i % 8));
+}
+
+void
+Flash::setTimeouts(uint32_t pageMs, uint32_t eraseMs)
+{
+    for (int op = 0; op < OP_COUNT; op++)
+    {
+        FlashTiming& timing = _timing[op];
+
+        timing.timeout = (op == OP_ERASE_ALL ? eraseMs : pageMs) * 1000;
+        // Worst case figures are pessimistic so the first poll starts
+        // early and the estimate grows from there
+        timing.expected = (op == OP_OTHER ? 0 : timing.timeout / 8);
+    }
+}
+
+const char*
+Flash::opName(FlashOp op)
+{
+    static const char* names[OP_COUNT] =
+    {
+        "write", "erase+write", "erase page", "erase all", "lock", "other"
+    };
+
+    return names[op];
+}
+
+void
+Flash::startOp(FlashOp op)
+{
+    _op = op;
+    gettimeofday(&_opStart, NULL);
+}
+
+void
+Flash::waitReady()
+{
+    FlashTiming& timing = _timing[_op < 0 ? OP_OTHER : _op];
+    uint32_t timeout = timing.timeout * 2 + FLASH_POLL_MARGIN;
+    uint32_t delay = FLASH_POLL_MIN;
+    uint32_t elapsed;
+    bool first = true;
+
+    // Without an outstanding command the controller is normally ready
+    // so it is polled straight away
+    if (_op < 0)
+        gettimeofday(&_opStart, NULL);
+    else if ((elapsed = elapsedUs(_opStart)) < timing.expected)
+        usleep(timing.expected - elapsed);
+
+    try
+    {
+        while (!pollReady())
+        {
+            first = false;
+            if (elapsedUs(_opStart) > timeout)
+                throw FlashCmdError();
+            usleep(delay);
+            delay = (delay * 2 > FLASH_POLL_MAX ? FLASH_POLL_MAX : delay * 2);
+        }
+    }
+    catch (...)
+    {
+        _op = -1;
+        throw;
+    }
+
+    if (_op >= 0)
+        finishOp(elapsedUs(_opStart), first);
+}
+
+void
+Flash::finishOp(uint32_t elapsed, bool firstPoll)
+{
+    FlashTiming& timing = _timing[_op];
+
+    timing.count++;
+    timing.total += elapsed;
+    if (elapsed > timing.max)
+        timing.max = elapsed;
+
+    // A first poll that finds the command done only bounds its time so
+    // the estimate creeps down until polls start to miss.  A miss moves
+    // the estimate a quarter of the way to the measured time.
+    if (firstPoll)
+        timing.expected -= timing.expected / 8;
+    else if (elapsed > timing.expected)
+        timing.expected += (elapsed - timing.expected) / 4;
+
+    _op = -1;
 }
@@ -21,10 +21,12 @@
 
 #include <stdint.h>
 #include <memory>
+#include <vector>
 #include <exception>
+#include <sys/time.h>
 
 #include "Samba.h"
-#include "WordCopyApplet.h"
+#include "CopyApplet.h"
 
 class FlashPageError : public std::exception
 {
@@ -54,9 +56,34 @@ public:
     const char* what() const throw() { return "Flash command failed"; }
 };
 
+// Completion time model of one kind of flash command.  Times are in
+// microseconds measured from issuing the command to seeing it ready.
+class FlashTiming
+{
+public:
+    FlashTiming() : expected(0), timeout(0), count(0), total(0), max(0) {}
+
+    uint32_t expected;      // Running estimate of the completion time
+    uint32_t timeout;       // Worst case before the command is failed
+    uint32_t count;
+    uint64_t total;
+    uint32_t max;
+};
+
 class Flash
 {
 public:
+    enum FlashOp
+    {
+        OP_WRITE,           // Page write
+        OP_ERASE_WRITE,     // Page erase and write
+        OP_ERASE_PAGE,
+        OP_ERASE_ALL,
+        OP_LOCK,            // Lock bit or GPNVM change
+        OP_OTHER,
+        OP_COUNT,
+    };
+
     Flash(Samba& samba,
           const std::string& name,
           uint32_t addr,
@@ -81,7 +108,9 @@ public:
     virtual uint32_t lockRegions() { return _lockRegions; }
     virtual bool isLocked() = 0;
     virtual bool getLockRegion(uint32_t region) = 0;
-    virtual void setLockRegion(uint32_t region, bool enable) = 0;
+    virtual void setLockRegion(uint32_t region, bool enable);
+    virtual void getLockRegions(std::vector<bool>& regions);
+    virtual void setLockRegions(const std::vector<bool>& regions);
     virtual void lockAll();
     virtual void unlockAll();
 
@@ -100,13 +129,37 @@ public:
     virtual void setBootFlash(bool enable) = 0;
     virtual bool canBootFlash() = 0;
 
+    virtual uint32_t bufferPages() { return _bufferPages; }
     virtual void loadBuffer(const uint8_t* data);
     virtual void writePage(uint32_t page) = 0;
+    virtual void writePages(uint32_t page, const uint8_t* data, uint32_t numPages);
     virtual void readPage(uint32_t page, uint8_t* data) = 0;
+    virtual void readPages(uint32_t page, uint8_t* data, uint32_t numPages);
+
+    virtual void checkBlank(uint32_t page, uint32_t numPages, std::vector<bool>& dirty);
+
+    void setTimeouts(uint32_t pageMs, uint32_t eraseMs);
+    const FlashTiming& timing(FlashOp op) { return _timing[op]; }
+    static const char* opName(FlashOp op);
 
     typedef std::auto_ptr<Flash> Ptr;
 
 protected:
+    void startOp(FlashOp op);
+    void waitReady();
+    virtual bool pollReady() = 0;
+
+    virtual void writeLockRegion(uint32_t region, bool enable) = 0;
+
+    virtual void runApplet(Applet& applet) = 0;
+
+    void setBuffers(uint32_t start);
+    uint32_t pageBuffer() { return _bufferAddr + _bufferSlot * _size; }
+    void nextBuffer() { _bufferSlot = (_bufferSlot + 1) % _bufferPages; }
+
+    bool canReadDirect();
+    void readFlash(uint32_t page, uint8_t* data, uint32_t numPages);
+
     Samba& _samba;
     std::string _name;
     uint32_t _addr;
@@ -115,11 +168,22 @@ protected:
     uint32_t _planes;
     uint32_t _lockRegions;
     uint32_t _user;
-    WordCopyApplet _wordCopy;
+    uint32_t _stack;
+    CopyApplet::Ptr _wordCopy;
+
+    uint32_t _bufferAddr;
+    uint32_t _bufferPages;
+    uint32_t _bufferSlot;
+
+    bool _directProbed;
+    bool _directRead;
+
+private:
+    FlashTiming _timing[OP_COUNT];
+    int _op;
+    struct timeval _opStart;
 
-    bool _onBufferA;
-    uint32_t _pageBufferA;
-    uint32_t _pageBufferB;
+    void finishOp(uint32_t elapsed, bool firstPoll);
 };
 
 #endif // _FLASH_H
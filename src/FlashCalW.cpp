@@ -19,7 +19,6 @@
 #include "FlashCalW.h"
 
 #include <assert.h>
-#include <unistd.h>
 #include <stdio.h>
 
 #define EEFC_KEY        0x5a
@@ -33,6 +32,7 @@
 
 #define FSR_FRDY       (1<<0)
 #define FSR_FLOCKE     (1<<2)
+#define FSR_PROGE      (1<<3)
 #define FSR_SECURITY   (1<<4)
 
 #define FCMD_KEY       0xA5
@@ -60,7 +60,8 @@ FlashCalW::FlashCalW(Samba& samba,
                      uint32_t regs,
                      bool canBrownout)
   : Flash(samba, name, addr, pages, size, 1, lockRegions, user, stack),
-      _regs(regs), _canBrownout(canBrownout), _eraseAuto(true)
+      _regs(regs), _canBrownout(canBrownout), _eraseAuto(true),
+      _calwWrite(samba, _bufferAddr)
 {
     assert(pages <= 1024);
     assert(lockRegions <= 32);
@@ -70,6 +71,13 @@ FlashCalW::FlashCalW(Samba& samba,
 
     assert(sambaRegionSize % size == 0); // SAM-BA region should end on a page boundary
     _reservedPages = sambaRegionSize / size;
+
+    // The write applet sits between the word copy applet and the page buffers
+    setBuffers(_calwWrite.addr() + _calwWrite.size());
+
+    _calwWrite.setRegs(_regs);
+    _calwWrite.setWords(size / sizeof(uint32_t));
+    _calwWrite.setStack(stack);
 }
 
 FlashCalW::~FlashCalW()
@@ -80,7 +88,7 @@ void
 FlashCalW::eraseAll()
 {
   throw FlashCmdError(); // Unsure if a full erase will also erase SAM-BA
-  waitFSR();
+  waitReady();
   writeFCMD(CMD_ERASEALL, 0);
 }
 
@@ -93,7 +101,7 @@ FlashCalW::eraseAuto(bool enable)
 bool
 FlashCalW::isLocked()
 {
-    waitFSR();
+    waitReady();
     uint32_t lock_mask = readFSR() >> 16;
     // TODO: this mask probably always shows the lower 0x4000 as locked, and rightly so
     return lock_mask;
@@ -105,40 +113,45 @@ FlashCalW::getLockRegion(uint32_t region)
     if (region >= _lockRegions)
         throw FlashRegionError();
 
-    waitFSR();
+    waitReady();
     uint32_t lock_mask = readFSR() >> 16;
     return lock_mask & (1<<region);
 }
 
 void
-FlashCalW::setLockRegion(uint32_t region, bool enable)
+FlashCalW::getLockRegions(std::vector<bool>& regions)
 {
-    uint32_t page;
+    regions.resize(_lockRegions);
 
-    if (region >= _lockRegions)
-        throw FlashRegionError();
+    waitReady();
+    uint32_t lock_mask = readFSR() >> 16;
+    for (uint32_t region = 0; region < _lockRegions; region++)
+        regions[region] = lock_mask & (1<<region);
+}
 
-    if (enable != getLockRegion(region))
-    {
-      page = region * _pages / _lockRegions;
-      if(!enable && _reservedPages && page < _reservedPages)
-        throw FlashPageError(); // TODO: make proper error
-      waitFSR();
-      writeFCMD(enable ? CMD_LP : CMD_UP, page);
-    }
+void
+FlashCalW::writeLockRegion(uint32_t region, bool enable)
+{
+    uint32_t page;
+
+    page = region * _pages / _lockRegions;
+    if(!enable && _reservedPages && page < _reservedPages)
+        throw FlashCalWReservedError();
+    waitReady();
+    writeFCMD(enable ? CMD_LP : CMD_UP, page);
 }
 
 bool
 FlashCalW::getSecurity()
 {
-    waitFSR();
+    waitReady();
     return readFSR() & FSR_SECURITY;
 }
 
 void
 FlashCalW::setSecurity()
 {
-    waitFSR();
+    waitReady();
     writeFCMD(CMD_SSB, 0);
 }
 
@@ -208,66 +221,117 @@ FlashCalW::writePage(uint32_t page)
     if (page >= _pages)
         throw FlashPageError();
 
-    if(page < _reservedPages)
-      throw FlashPageError(); // TODO: Make a proper error message
+    runWrite(page, pageBuffer(), 1);
+    nextBuffer();
+}
 
-    if(_eraseAuto) {
-      waitFSR();
-      writeFCMD(getErasePageCommand(), page);
-    }
+void
+FlashCalW::writePages(uint32_t page, const uint8_t* data, uint32_t numPages)
+{
+    uint32_t batch;
 
-    waitFSR();
-    writeFCMD(CMD_CPB, 0);
+    if (page + numPages > _pages)
+        throw FlashPageError();
 
-    waitFSR();
-    _wordCopy.setDstAddr(_addr + page * _size);
-    _wordCopy.setSrcAddr(_onBufferA ? _pageBufferA : _pageBufferB);
-    _onBufferA = !_onBufferA;
-    _wordCopy.runv();
+    // The page buffer ring is contiguous so a batch of pages is loaded
+    // with a single transfer and programmed with a single applet run
+    while (numPages > 0)
+    {
+        batch = numPages < _bufferPages ? numPages : _bufferPages;
+        _samba.write(_bufferAddr, data, batch * _size);
+        runWrite(page, _bufferAddr, batch);
+        _bufferSlot = 0;
+
+        page += batch;
+        data += batch * _size;
+        numPages -= batch;
+    }
+}
 
-    waitFSR();
-    writeFCMD(getWritePageCommand(), page);
+void
+FlashCalW::runWrite(uint32_t page, uint32_t srcAddr, uint32_t numPages)
+{
+    uint32_t status;
+
+    if (page < _reservedPages)
+        throw FlashCalWReservedError();
+
+    // The applet erases, clears the page buffer, fills it and writes each
+    // page in turn, polling FRDY on the device instead of over the link
+    _calwWrite.setDstAddr(_addr + page * _size);
+    _calwWrite.setSrcAddr(srcAddr);
+    _calwWrite.setPage(page);
+    _calwWrite.setPages(numPages);
+    _calwWrite.setEraseCmd(_eraseAuto ? getErasePageCommand() : 0);
+    _calwWrite.setWriteCmd(getWritePageCommand());
+    _calwWrite.runv();
+
+    status = _calwWrite.getStatus();
+    if (status & FSR_FLOCKE)
+        throw FlashLockError();
+    if (status & FSR_PROGE)
+        throw FlashCmdError();
 }
 
 void
 FlashCalW::readPage(uint32_t page, uint8_t* data)
 {
-    if (page >= _pages)
+    readPages(page, data, 1);
+}
+
+void
+FlashCalW::readPages(uint32_t page, uint8_t* data, uint32_t numPages)
+{
+    if (page + numPages > _pages)
         throw FlashPageError();
 
-    // The SAM3 firmware has a bug where it returns all zeros for reads
-    // directly from the flash so instead, we copy the flash page to
-    // SRAM and read it from there.
-    // TODO: test if this is the case for SAM4 too
-    _wordCopy.setDstAddr(_onBufferA ? _pageBufferA : _pageBufferB);
-    _wordCopy.setSrcAddr(_addr + page * _size);
-    waitFSR();
-    _wordCopy.runv();
-    _samba.read(_onBufferA ? _pageBufferA : _pageBufferB, data, _size);
+    // Direct flash reads are probed by readFlash() since the SAM3
+    // firmware bug may also affect SAM4 monitors
+    waitReady();
+    readFlash(page, data, numPages);
 }
 
 void
-FlashCalW::waitFSR()
+FlashCalW::runApplet(Applet& applet)
+{
+    waitReady();
+    applet.runv();
+}
+
+bool
+FlashCalW::pollReady()
 {
-    uint32_t tries = 0;
-    uint32_t fsr;
+    uint32_t fsr = readFSR();
 
-    while (++tries <= 500)
-    {
-      fsr = readFSR();
-      if (fsr & FSR_FLOCKE)
+    if (fsr & FSR_FLOCKE)
         throw FlashLockError();
-      if (fsr & FSR_FRDY)
-        break;
-      usleep(100);
-    }
-    if (tries > 500)
-      throw FlashCmdError();
+    return fsr & FSR_FRDY;
 }
 
 void
 FlashCalW::writeFCMD(uint8_t cmd, uint16_t page)
 {
+  switch (cmd)
+  {
+  case CMD_WP:
+  case CMD_WUP:
+    startOp(OP_WRITE);
+    break;
+  case CMD_EP:
+  case CMD_EUP:
+    startOp(OP_ERASE_PAGE);
+    break;
+  case CMD_ERASEALL:
+    startOp(OP_ERASE_ALL);
+    break;
+  case CMD_LP:
+  case CMD_UP:
+    startOp(OP_LOCK);
+    break;
+  default:
+    startOp(OP_OTHER);
+    break;
+  }
   _samba.writeWord(CALW_FCMD, (FCMD_KEY << 24) | (((uint32_t)page) << 8) | cmd);
 }
 
@@ -302,7 +366,7 @@ void
 FlashCalWUserPage::eraseAll()
 {
   // User page is only one page, so we just erase it
-  waitFSR();
+  waitReady();
   writeFCMD(CMD_EUP, 0);
 }
 
@@ -326,6 +390,12 @@ FlashCalWUserPage::setLockRegion(uint32_t region, bool enable)
   throw FlashRegionError();
 }
 
+void
+FlashCalWUserPage::writeLockRegion(uint32_t region, bool enable)
+{
+  throw FlashRegionError();
+}
+
 uint32_t
 FlashCalWUserPage::getWritePageCommand()
 {
@@ -24,6 +24,14 @@
 #include <exception>
 
 #include "Flash.h"
+#include "CalwWriteApplet.h"
+
+class FlashCalWReservedError : public std::exception
+{
+public:
+    FlashCalWReservedError() : exception() {};
+    const char* what() const throw() { return "Flash page is reserved for SAM-BA"; }
+};
 
 class FlashCalW : public Flash
 {
@@ -46,7 +54,7 @@ public:
 
     virtual bool isLocked();
     virtual bool getLockRegion(uint32_t region);
-    virtual void setLockRegion(uint32_t region, bool enable);
+    virtual void getLockRegions(std::vector<bool>& regions);
 
     bool getSecurity();
     void setSecurity();
@@ -64,20 +72,27 @@ public:
     bool canBootFlash() { return true; }
 
     void writePage(uint32_t page);
+    void writePages(uint32_t page, const uint8_t* data, uint32_t numPages);
     void readPage(uint32_t page, uint8_t* data);
+    void readPages(uint32_t page, uint8_t* data, uint32_t numPages);
 
 protected:
-    void waitFSR();
+    virtual void writeLockRegion(uint32_t region, bool enable);
+    virtual void runApplet(Applet& applet);
+
+    bool pollReady();
     void writeFCMD(uint8_t cmd, uint16_t page);
 private:
     uint32_t _regs;
     bool _canBrownout;
     bool _eraseAuto;
     uint32_t _reservedPages;
+    CalwWriteApplet _calwWrite;
 
     virtual uint32_t getWritePageCommand();
     virtual uint32_t getErasePageCommand();
 
+    void runWrite(uint32_t page, uint32_t srcAddr, uint32_t numPages);
     uint32_t readFSR();
 };
 
@@ -99,6 +114,8 @@ public:
     bool isLocked();
     bool getLockRegion(uint32_t region);
     void setLockRegion(uint32_t region, bool enable);
+ protected:
+    void writeLockRegion(uint32_t region, bool enable);
  private:
     uint32_t getWritePageCommand();
     uint32_t getErasePageCommand();
@@ -23,6 +23,7 @@
 
 #include "Samba.h"
 #include "Flash.h"
+#include "Device.h"
 
 class FlashFactory
 {
@@ -30,7 +31,14 @@ public:
     FlashFactory();
     virtual ~FlashFactory();
 
-    Flash::Ptr create(Samba& samba, uint32_t chipId, bool user_page);
+    Flash::Ptr create(Samba& samba, uint32_t chipId, bool user_page = false);
+
+    const Device* device(uint32_t chipId);
+    DeviceDb& devices() { return _devices; }
+
+private:
+    DeviceDb _devices;
+    bool _loaded;
 };
 
 #endif // _FLASHFACTORY_H
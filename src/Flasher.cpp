@@ -20,19 +20,34 @@
 #include <exception>
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <assert.h>
+#include <algorithm>
 #include "Flasher.h"
 
 using namespace std;
 
 void
-Flasher::progressBar(int num, int div)
+FlasherConsole::onStatus(const char* message, ...)
+{
+    va_list ap;
+
+    va_start(ap, message);
+    vprintf(message, ap);
+    va_end(ap);
+}
+
+void
+FlasherConsole::onProgress(int num, int div)
 {
     int ticks;
     int bars = 30;
 
+    if (div == 0)
+        return;
+
     printf("\r[");
     ticks = num * bars / div;
     while (ticks-- > 0)
@@ -45,36 +60,51 @@ Flasher::progressBar(int num, int div)
         putchar(' ');
     }
     printf("] %d%% (%d/%d pages)", num * 100 / div, num, div);
+    if (num == div)
+        printf("\n");
     fflush(stdout);
 }
 
+void
+Flasher::progress(int num, int div)
+{
+    _observer.onProgress(num, div);
+
+    // Operations only stop between batches so the flash is never left
+    // with a partially written page
+    if (num < div && _observer.isCancelled())
+        throw FlasherCancelError();
+}
+
 void
 Flasher::erase()
 {
-    printf("Erase flash\n");
-    _flash->eraseAll();
+    std::vector<bool> dirty;
+
+    _flash->checkBlank(0, _flash->numPages(), dirty);
+    if (find(dirty.begin(), dirty.end(), true) == dirty.end())
+    {
+        _observer.onStatus("Flash is already blank\n");
+    }
+    else
+    {
+        _observer.onStatus("Erase flash\n");
+        _flash->eraseAll();
+    }
     _flash->eraseAuto(false);
+    _erased = true;
 }
 
 void
-Flasher::write(const char* filename, long offset)
+Flasher::loadFile(const char* filename, long offset, std::vector<uint8_t>& data)
 {
     FILE* infile;
-    uint32_t pageSize = _flash->pageSize();
-    uint8_t buffer[pageSize];
-    uint32_t pageNum = 0;
-    uint32_t pageOffset;
-    uint32_t numPages;
     long fsize;
-    size_t fbytes;
 
     infile = fopen(filename, "rb");
     if (!infile)
         throw FileOpenError(errno);
 
-    assert(offset % pageSize == 0);
-    pageOffset = offset / pageSize;
-
     try
     {
         if (fseek(infile, 0, SEEK_END) != 0 ||
@@ -82,83 +112,188 @@ Flasher::write(const char* filename, long offset)
             throw FileIoError(errno);
         rewind(infile);
 
-        numPages = (fsize + pageSize - 1) / pageSize;
-        if (numPages + pageOffset > _flash->numPages())
+        // Refuse oversized files before reading them into memory
+        if (offset + fsize > (long) (_flash->numPages() * _flash->pageSize()))
             throw FileSizeError();
 
-        printf("Write %ld bytes to flash starting from flash offset 0x%lx\n", fsize, offset);
+        data.resize(fsize);
+        if (fsize > 0 && fread(&data[0], 1, fsize, infile) != (size_t) fsize)
+        {
+            if (ferror(infile))
+                throw FileIoError(errno);
+            throw FileShortError();
+        }
+    }
+    catch(...)
+    {
+        fclose(infile);
+        throw;
+    }
+    fclose(infile);
+}
+
+void
+Flasher::write(const char* filename, long offset)
+{
+    std::vector<uint8_t> data;
+
+    loadFile(filename, offset, data);
+    write(data.empty() ? NULL : &data[0], data.size(), offset);
+}
+
+void
+Flasher::write(const uint8_t* data, uint32_t size, long offset)
+{
+    uint32_t pageSize = _flash->pageSize();
+    uint32_t bufferPages = _flash->bufferPages();
+    std::vector<uint8_t> buffer(pageSize * bufferPages);
+    uint32_t pageNum = 0;
+    uint32_t pageOffset;
+    uint32_t numPages;
+    uint32_t batch;
+    uint32_t bytes;
+    std::vector<bool> dirty;
+    bool eraseAuto = true;
+    bool erased;
+
+    assert(offset % pageSize == 0);
+    pageOffset = offset / pageSize;
+
+    numPages = (size + pageSize - 1) / pageSize;
+    if (numPages + pageOffset > _flash->numPages())
+        throw FileSizeError();
+
+    // An erase only vouches for the first write after it; once pages
+    // are written, later writes must check for themselves
+    erased = _erased;
+    _erased = false;
+
+    _observer.onStatus("Write %ld bytes to flash starting from flash offset 0x%lx\n", (long) size, offset);
+
+    try
+    {
+        // Without a prior erase, only pages that are not already blank
+        // need to be erased as they are written
+        if (!erased)
+        {
+            _flash->eraseAuto(true);
+            _flash->checkBlank(pageOffset, numPages, dirty);
+        }
 
-        while ((fbytes = fread(buffer, 1, pageSize, infile)) > 0)
+        while (pageNum < numPages)
         {
-            if (pageNum % 10 == 0)
-                progressBar(pageNum, numPages);
+            progress(pageNum, numPages);
+
+            batch = numPages - pageNum;
+            if (batch > bufferPages)
+                batch = bufferPages;
+
+            if (!erased)
+            {
+                for (uint32_t page = 1; page < batch; page++)
+                {
+                    if (dirty[pageNum + page] != dirty[pageNum])
+                    {
+                        batch = page;
+                        break;
+                    }
+                }
+                if (dirty[pageNum] != eraseAuto)
+                {
+                    eraseAuto = dirty[pageNum];
+                    _flash->eraseAuto(eraseAuto);
+                }
+            }
 
-            _flash->loadBuffer(buffer);
-            _flash->writePage(pageNum+pageOffset);
+            bytes = batch * pageSize;
+            if (pageNum * pageSize + bytes > size)
+                bytes = size - pageNum * pageSize;
+            memcpy(&buffer[0], data + pageNum * pageSize, bytes);
+            // Pad the last partial page with the erased value
+            memset(&buffer[0] + bytes, 0xff, batch * pageSize - bytes);
 
-            pageNum++;
-            if (pageNum == numPages || fbytes != pageSize)
-                break;
+            _flash->writePages(pageNum + pageOffset, &buffer[0], batch);
+
+            pageNum += batch;
         }
-        if (fbytes < 0)
-            throw FileIoError(errno);
-        progressBar(pageNum, numPages);
-        printf("\n");
+        progress(pageNum, numPages);
     }
     catch(...)
     {
-        fclose(infile);
+        if (!eraseAuto)
+            _flash->eraseAuto(true);
         throw;
     }
-    fclose(infile);
+
+    if (!eraseAuto)
+        _flash->eraseAuto(true);
 }
 
 bool
 Flasher::verify(const char* filename, long offset)
 {
-    FILE* infile;
+    uint32_t pageErrors;
+    uint32_t totalErrors;
+
+    return verify(filename, offset, pageErrors, totalErrors);
+}
+
+bool
+Flasher::verify(const char* filename, long offset,
+                uint32_t& pageErrors, uint32_t& totalErrors)
+{
+    std::vector<uint8_t> data;
+
+    loadFile(filename, offset, data);
+    return verify(data.empty() ? NULL : &data[0], data.size(), offset,
+                  pageErrors, totalErrors);
+}
+
+bool
+Flasher::verify(const uint8_t* data, uint32_t size, long offset,
+                uint32_t& pageErrors, uint32_t& totalErrors)
+{
     uint32_t pageSize = _flash->pageSize();
-    uint8_t bufferA[pageSize];
-    uint8_t bufferB[pageSize];
+    uint32_t bufferPages = _flash->bufferPages();
+    std::vector<uint8_t> buffer(pageSize * bufferPages);
     uint32_t pageNum = 0;
     uint32_t pageOffset;
     uint32_t numPages;
+    uint32_t batch;
     uint32_t byteErrors = 0;
-    uint32_t pageErrors = 0;
-    uint32_t totalErrors = 0;
-    long fsize;
-    size_t fbytes;
+    uint32_t start;
+    uint32_t end;
 
-    infile = fopen(filename, "rb");
-    if (!infile)
-        throw FileOpenError(errno);
+    pageErrors = 0;
+    totalErrors = 0;
 
     assert(offset % pageSize == 0);
     pageOffset = offset / pageSize;
 
-    try
-    {
-        if (fseek(infile, 0, SEEK_END) != 0 ||
-            (fsize = ftell(infile)) < 0)
-            throw FileIoError(errno);
-        rewind(infile);
+    numPages = (size + pageSize - 1) / pageSize;
+    if (numPages + pageOffset > _flash->numPages())
+        throw FileSizeError();
 
-        numPages = (fsize + pageSize - 1) / pageSize;
-        if (numPages + pageOffset > _flash->numPages())
-            throw FileSizeError();
+    _observer.onStatus("Verify %ld bytes of flash starting from flash offset 0x%lx\n", (long) size, offset);
 
-        printf("Verify %ld bytes of flash starting from flash offset 0x%lx\n", fsize, offset);
+    while (pageNum < numPages)
+    {
+        progress(pageNum, numPages);
 
-        while ((fbytes = fread(bufferA, 1, pageSize, infile)) > 0)
-        {
-            if (pageNum % 10 == 0)
-                progressBar(pageNum, numPages);
+        batch = numPages - pageNum;
+        if (batch > bufferPages)
+            batch = bufferPages;
 
-            _flash->readPage(pageNum+pageOffset, bufferB);
+        _flash->readPages(pageNum + pageOffset, &buffer[0], batch);
 
-            for (uint32_t i = 0; i < fbytes; i++)
+        for (uint32_t page = 0; page < batch; page++)
+        {
+            byteErrors = 0;
+            start = (pageNum + page) * pageSize;
+            end = min(start + pageSize, size);
+            for (uint32_t i = start; i < end; i++)
             {
-                if (bufferA[i] != bufferB[i])
+                if (data[i] != buffer[i - pageNum * pageSize])
                     byteErrors++;
             }
             if (byteErrors != 0)
@@ -166,32 +301,21 @@ Flasher::verify(const char* filename, long offset)
                 pageErrors++;
                 totalErrors += byteErrors;
             }
-
-            pageNum++;
-            if (pageNum == numPages || fbytes != pageSize)
-                break;
         }
-        if (fbytes < 0)
-            throw FileIoError(errno);
-        progressBar(pageNum, numPages);
-        printf("\n");
-    }
-    catch(...)
-    {
-        fclose(infile);
-        throw;
+
+        pageNum += batch;
     }
-    fclose(infile);
+    progress(pageNum, numPages);
 
-    if (byteErrors != 0)
+    if (totalErrors != 0)
     {
-        printf("Verify failed\n");
-        printf("Page errors: %d\n", pageErrors);
-        printf("Byte errors: %d\n", totalErrors);
+        _observer.onStatus("Verify failed\n");
+        _observer.onStatus("Page errors: %d\n", pageErrors);
+        _observer.onStatus("Byte errors: %d\n", totalErrors);
         return false;
     }
 
-    printf("Verify successful\n");
+    _observer.onStatus("Verify successful\n");
     return true;
 }
 
@@ -199,18 +323,12 @@ void
 Flasher::read(const char* filename, long offset, long fsize)
 {
     FILE* outfile;
-    uint32_t pageSize = _flash->pageSize();
-    uint8_t buffer[pageSize];
-    uint32_t pageNum = 0;
-    uint32_t pageOffset;
-    uint32_t numPages;
-    size_t fbytes;
-
-    assert(offset % pageSize == 0);
-    pageOffset = offset / pageSize;
+    std::vector<uint8_t> data;
 
     if (fsize == 0)
-      fsize = pageSize * (_flash->numPages() - pageOffset);
+        fsize = _flash->pageSize() * _flash->numPages() - offset;
+    if (fsize < 0 || offset + fsize > (long) (_flash->numPages() * _flash->pageSize()))
+        throw FileSizeError();
 
     outfile = fopen(filename, "wb");
     if (!outfile)
@@ -218,29 +336,15 @@ Flasher::read(const char* filename, long offset, long fsize)
 
     try
     {
-        numPages = (fsize + pageSize - 1) / pageSize;
-        if (numPages + pageOffset > _flash->numPages())
-            throw FileSizeError();
-
-        printf("Read %ld bytes from flash starting from offset 0x%lx\n", fsize, offset);
+        data.resize(fsize);
+        read(data.empty() ? NULL : &data[0], fsize, offset);
 
-        for (pageNum = 0; pageNum < numPages; pageNum++)
+        if (fsize > 0 && fwrite(&data[0], 1, fsize, outfile) != (size_t) fsize)
         {
-            if (pageNum % 10 == 0)
-                progressBar(pageNum, numPages);
-
-            _flash->readPage(pageNum+pageOffset, buffer);
-
-            if (pageNum == numPages - 1 && fsize % pageSize > 0)
-                pageSize = fsize % pageSize;
-            fbytes = fwrite(buffer, 1, pageSize, outfile);
-            if (fbytes < 0)
+            if (ferror(outfile))
                 throw FileIoError(errno);
-            if (fbytes != pageSize)
-                throw FileShortError();
+            throw FileShortError();
         }
-        progressBar(pageNum, numPages);
-        printf("\n");
     }
     catch(...)
     {
@@ -250,12 +354,59 @@ Flasher::read(const char* filename, long offset, long fsize)
     fclose(outfile);
 }
 
+void
+Flasher::read(uint8_t* data, uint32_t size, long offset)
+{
+    uint32_t pageSize = _flash->pageSize();
+    uint32_t bufferPages = _flash->bufferPages();
+    std::vector<uint8_t> buffer(pageSize * bufferPages);
+    uint32_t pageNum = 0;
+    uint32_t pageOffset;
+    uint32_t numPages;
+    uint32_t batch;
+    uint32_t bytes;
+
+    assert(offset % pageSize == 0);
+    pageOffset = offset / pageSize;
+
+    numPages = (size + pageSize - 1) / pageSize;
+    if (numPages + pageOffset > _flash->numPages())
+        throw FileSizeError();
+
+    _observer.onStatus("Read %ld bytes from flash starting from offset 0x%lx\n", (long) size, offset);
+
+    while (pageNum < numPages)
+    {
+        progress(pageNum, numPages);
+
+        batch = numPages - pageNum;
+        if (batch > bufferPages)
+            batch = bufferPages;
+
+        // Whole pages go straight to the caller and only a trailing
+        // partial page is staged
+        bytes = batch * pageSize;
+        if (pageNum * pageSize + bytes <= size)
+        {
+            _flash->readPages(pageNum + pageOffset, data + pageNum * pageSize, batch);
+        }
+        else
+        {
+            _flash->readPages(pageNum + pageOffset, &buffer[0], batch);
+            memcpy(data + pageNum * pageSize, &buffer[0], size - pageNum * pageSize);
+        }
+
+        pageNum += batch;
+    }
+    progress(pageNum, numPages);
+}
+
 void
 Flasher::lock(string& regionArg, bool enable)
 {
     if (regionArg.empty())
     {
-        printf("%s all regions\n", enable ? "Lock" : "Unlock");
+        _observer.onStatus("%s all regions\n", enable ? "Lock" : "Unlock");
         if (enable)
             _flash->lockAll();
         else
@@ -267,16 +418,23 @@ Flasher::lock(string& regionArg, bool enable)
         size_t delim;
         uint32_t region;
         string sub;
+        std::vector<bool> regions;
 
+        // Apply the whole list to one snapshot so only changed
+        // regions are written back to the device
+        _flash->getLockRegions(regions);
         do
         {
             delim = regionArg.find(',', pos);
             sub = regionArg.substr(pos, delim < 0 ? -1 : delim - pos);
             region = strtol(sub.c_str(), NULL, 0);
-            printf("%s region %d\n", enable ? "Lock" : "Unlock", region);
-            _flash->setLockRegion(region, enable);
+            if (region >= regions.size())
+                throw FlashRegionError();
+            _observer.onStatus("%s region %d\n", enable ? "Lock" : "Unlock", region);
+            regions[region] = enable;
             pos = delim + 1;
         } while (delim != string::npos);
+        _flash->setLockRegions(regions);
     }
 }
 
@@ -284,10 +442,26 @@ void
 Flasher::info(Samba& samba)
 {
     bool first;
+    std::vector<bool> regions;
+    std::vector<bool> dirty;
+    uint32_t start;
 
     printf("Device       : %s\n", _flash->name().c_str());
     printf("Chip ID      : %08x\n", samba.chipId());
     printf("Version      : %s\n", samba.version().c_str());
+    printf("Quirks       : ");
+    first = true;
+    if (samba.info().quirks & ChipInfo::QUIRK_READ_POW2)
+    {
+        printf("read-pow2");
+        first = false;
+    }
+    if (samba.info().quirks & ChipInfo::QUIRK_PACKET_MERGE)
+    {
+        printf("%spacket-merge", first ? "" : ",");
+        first = false;
+    }
+    printf("%s\n", first ? "none" : "");
     printf("Address      : %d\n", _flash->address());
     printf("Pages        : %d\n", _flash->numPages());
     printf("Page Size    : %d bytes\n", _flash->pageSize());
@@ -296,15 +470,32 @@ Flasher::info(Samba& samba)
     printf("Lock Regions : %d\n", _flash->lockRegions());
     printf("Locked       : ");
     first = true;
-    for (uint32_t region = 0; region < _flash->lockRegions(); region++)
+    _flash->getLockRegions(regions);
+    for (uint32_t region = 0; region < regions.size(); region++)
     {
-        if (_flash->getLockRegion(region))
+        if (regions[region])
         {
             printf("%s%d", first ? "" : ",", region);
             first = false;
         }
     }
     printf("%s\n", first ? "none" : "");
+    printf("Blank Pages  : ");
+    first = true;
+    _flash->checkBlank(0, _flash->numPages(), dirty);
+    for (uint32_t page = 0; page < dirty.size(); page++)
+    {
+        if (dirty[page])
+            continue;
+        for (start = page; page + 1 < dirty.size() && !dirty[page + 1]; page++)
+            ;
+        if (start == page)
+            printf("%s%d", first ? "" : ",", start);
+        else
+            printf("%s%d-%d", first ? "" : ",", start, page);
+        first = false;
+    }
+    printf("%s\n", first ? "none" : "");
     printf("Security     : %s\n", _flash->getSecurity() ? "true" : "false");
     if (_flash->canBootFlash())
         printf("Boot Flash   : %s\n", _flash->getBootFlash() ? "true" : "false");
@@ -313,3 +504,21 @@ Flasher::info(Samba& samba)
     if (_flash->canBor())
         printf("BOR          : %s\n", _flash->getBor() ? "true" : "false");
 }
+
+void
+Flasher::stats()
+{
+    printf("Flash command timing (ms):\n");
+    printf("  %-12s %6s %8s %8s %8s\n", "Command", "Count", "Average", "Max", "Learned");
+    for (int op = 0; op < Flash::OP_COUNT; op++)
+    {
+        const FlashTiming& timing = _flash->timing((Flash::FlashOp) op);
+
+        if (timing.count == 0)
+            continue;
+        printf("  %-12s %6u %8.2f %8.2f %8.2f\n",
+               Flash::opName((Flash::FlashOp) op), timing.count,
+               timing.total / 1000.0 / timing.count,
+               timing.max / 1000.0, timing.expected / 1000.0);
+    }
+}
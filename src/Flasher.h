@@ -21,6 +21,7 @@
 
 #include <string>
 #include <exception>
+#include <vector>
 
 #include "Flash.h"
 #include "Samba.h"
@@ -33,23 +34,66 @@ public:
     virtual const char* what() const throw() { return "file operation exceeds flash size"; }
 };
 
+class FlasherCancelError : public std::exception
+{
+public:
+    FlasherCancelError() : exception() {};
+    virtual const char* what() const throw() { return "operation cancelled"; }
+};
+
+// Front ends receive status messages and progress of flash operations
+// through an observer which may also ask for the operation to stop
+class FlasherObserver
+{
+public:
+    FlasherObserver() {}
+    virtual ~FlasherObserver() {}
+
+    virtual void onStatus(const char* message, ...) = 0;
+    virtual void onProgress(int num, int div) = 0;
+    virtual bool isCancelled() { return false; }
+};
+
+class FlasherConsole : public FlasherObserver
+{
+public:
+    FlasherConsole() {}
+    virtual ~FlasherConsole() {}
+
+    virtual void onStatus(const char* message, ...);
+    virtual void onProgress(int num, int div);
+};
+
 class Flasher
 {
 public:
-    Flasher(Flash::Ptr& flash) : _flash(flash) {}
+    Flasher(Flash::Ptr& flash, FlasherObserver& observer)
+        : _flash(flash), _observer(observer), _erased(false) {}
     virtual ~Flasher() {}
 
     void erase();
     void write(const char* filename, long offset);
     bool verify(const char* filename, long offset);
+    bool verify(const char* filename, long offset,
+                uint32_t& pageErrors, uint32_t& totalErrors);
     void read(const char* filename, long offset, long fsize);
+
+    // The same operations on a range of flash held in memory
+    void write(const uint8_t* data, uint32_t size, long offset);
+    bool verify(const uint8_t* data, uint32_t size, long offset,
+                uint32_t& pageErrors, uint32_t& totalErrors);
+    void read(uint8_t* data, uint32_t size, long offset);
     void lock(std::string& regionArg, bool enable);
     void info(Samba& samba);
+    void stats();
 
 private:
-    void progressBar(int num, int div);
+    void progress(int num, int div);
+    void loadFile(const char* filename, long offset, std::vector<uint8_t>& data);
 
     Flash::Ptr& _flash;
+    FlasherObserver& _observer;
+    bool _erased;
 };
 
 #endif // _FLASHER_H
@@ -0,0 +1,176 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#include "MemoryCache.h"
+
+#include <stdio.h>
+#include <string.h>
+
+MemoryCache::MemoryCache(Samba& samba) :
+    _samba(samba), _enabled(true), _hits(0), _misses(0)
+{
+}
+
+MemoryCache::~MemoryCache()
+{
+}
+
+bool
+MemoryCache::cacheable(uint32_t addr, uint32_t size)
+{
+    uint64_t end = (uint64_t) addr + size;
+
+    if (!_enabled || size == 0)
+        return false;
+
+    for (std::vector<Range>::iterator it = _ranges.begin();
+         it != _ranges.end();
+         it++)
+    {
+        if (addr >= it->start && end <= it->end)
+            return true;
+    }
+
+    return false;
+}
+
+void
+MemoryCache::read(uint32_t addr, uint8_t* buffer, uint32_t size)
+{
+    uint32_t first;
+    uint32_t last;
+    uint32_t page;
+    uint32_t missing;
+    uint32_t offset;
+    uint32_t count;
+
+    if (!cacheable(addr, size) || size > MAX_PAGES * PAGE_SIZE / 2)
+    {
+        _samba.read(addr, buffer, size);
+        return;
+    }
+
+    first = addr / PAGE_SIZE;
+    last = (addr + size - 1) / PAGE_SIZE;
+
+    // Keep memory use bounded by starting over when the cache is full
+    if (_pages.size() + (last - first + 1) > MAX_PAGES)
+        flush();
+
+    // Fetch each run of missing pages with a single block read
+    for (page = first; page <= last; page++)
+    {
+        if (_pages.find(page) != _pages.end())
+        {
+            _hits++;
+            continue;
+        }
+
+        for (missing = 1;
+             page + missing <= last && _pages.find(page + missing) == _pages.end();
+             missing++);
+
+        fetch(page, missing);
+        _misses += missing;
+        page += missing - 1;
+    }
+
+    for (page = first; page <= last; page++)
+    {
+        offset = (page == first) ? addr % PAGE_SIZE : 0;
+        count = PAGE_SIZE - offset;
+        if (count > size)
+            count = size;
+
+        memcpy(buffer, &_pages[page][offset], count);
+        buffer += count;
+        size -= count;
+    }
+}
+
+void
+MemoryCache::fetch(uint32_t first, uint32_t count)
+{
+    std::vector<uint8_t> data(count * PAGE_SIZE);
+
+    _samba.read(first * PAGE_SIZE, &data[0], data.size());
+
+    for (uint32_t i = 0; i < count; i++)
+        _pages[first + i].assign(data.begin() + i * PAGE_SIZE,
+                                 data.begin() + (i + 1) * PAGE_SIZE);
+}
+
+void
+MemoryCache::addRange(uint32_t addr, uint32_t size)
+{
+    Range range;
+
+    // Cached pages are whole so the range is widened to page boundaries
+    range.start = addr & ~(PAGE_SIZE - 1);
+    range.end = ((uint64_t) addr + size + PAGE_SIZE - 1) & ~(uint64_t) (PAGE_SIZE - 1);
+
+    _ranges.push_back(range);
+}
+
+void
+MemoryCache::clearRanges()
+{
+    _ranges.clear();
+    flush();
+}
+
+void
+MemoryCache::invalidate(uint32_t addr, uint32_t size)
+{
+    PageMap::iterator it;
+    PageMap::iterator end;
+
+    if (size == 0 || _pages.empty())
+        return;
+
+    it = _pages.lower_bound(addr / PAGE_SIZE);
+    end = _pages.upper_bound((uint32_t) (((uint64_t) addr + size - 1) / PAGE_SIZE));
+    _pages.erase(it, end);
+}
+
+void
+MemoryCache::flush()
+{
+    _pages.clear();
+}
+
+void
+MemoryCache::setEnabled(bool enabled)
+{
+    _enabled = enabled;
+    if (!enabled)
+        flush();
+}
+
+void
+MemoryCache::info()
+{
+    printf("Cache         : %s\n", _enabled ? "enabled" : "disabled");
+    for (std::vector<Range>::iterator it = _ranges.begin();
+         it != _ranges.end();
+         it++)
+        printf("Range         : %08x-%08x\n", it->start, (uint32_t) (it->end - 1));
+    printf("Cached Pages  : %u of %u pages\n", (uint32_t) _pages.size(), MAX_PAGES);
+    printf("Page Size     : %u bytes\n", PAGE_SIZE);
+    printf("Hits/Misses   : %u/%u\n", _hits, _misses);
+}
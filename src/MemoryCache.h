@@ -0,0 +1,70 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef _MEMORYCACHE_H
+#define _MEMORYCACHE_H
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+#include "Samba.h"
+
+class MemoryCache
+{
+public:
+    MemoryCache(Samba& samba);
+    virtual ~MemoryCache();
+
+    void read(uint32_t addr, uint8_t* buffer, uint32_t size);
+    bool cacheable(uint32_t addr, uint32_t size);
+
+    void addRange(uint32_t addr, uint32_t size);
+    void clearRanges();
+
+    void invalidate(uint32_t addr, uint32_t size);
+    void flush();
+
+    void setEnabled(bool enabled);
+    bool enabled() { return _enabled; }
+
+    void info();
+
+    static const uint32_t PAGE_SIZE = 256;
+    static const uint32_t MAX_PAGES = 4096;
+
+private:
+    struct Range
+    {
+        uint32_t start;
+        uint64_t end;       // Exclusive
+    };
+
+    typedef std::map<uint32_t, std::vector<uint8_t> > PageMap;
+
+    Samba& _samba;
+    bool _enabled;
+    std::vector<Range> _ranges;
+    PageMap _pages;
+    uint32_t _hits;
+    uint32_t _misses;
+
+    void fetch(uint32_t first, uint32_t count);
+};
+
+#endif // _MEMORYCACHE_H
@@ -0,0 +1,667 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#include "MemorySerialPort.h"
+#include "FileError.h"
+#include "Crc16.h"
+#include "BlankCheckApplet.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define min(a, b)   ((a) < (b) ? (a) : (b))
+
+// Registers probed by Samba when connecting
+#define CHIPID_CIDR_SAM7    0xfffff240
+#define CHIPID_CIDR_SAM3    0x400e0740
+
+#define FSR_FRDY            (1 << 0)
+
+// XMODEM definitions
+#define BLK_SIZE            128
+#define SOH                 0x01
+#define EOT                 0x04
+#define ACK                 0x06
+#define NAK                 0x15
+#define START               'C'
+
+#define ELF_PT_LOAD         1
+#define ELF_EM_ARM          40
+
+MemorySerialPort::MemorySerialPort(const std::string& name, bool usb) :
+    SerialPort(name), _usb(usb), _bug(BUG_NONE), _outPos(0), _sendAddr(0), _sendBytes(0),
+    _xmodem(XMODEM_NONE), _xmodemPos(0), _xmodemEot(false)
+{
+}
+
+MemorySerialPort::~MemorySerialPort()
+{
+}
+
+bool
+MemorySerialPort::open(int baud,
+                       int data,
+                       SerialPort::Parity parity,
+                       SerialPort::StopBit stop)
+{
+    _cmd.clear();
+    _packet.clear();
+    _out.clear();
+    _outPos = 0;
+    _sendBytes = 0;
+    _xmodem = XMODEM_NONE;
+    _block.clear();
+
+    return true;
+}
+
+void
+MemorySerialPort::close()
+{
+}
+
+int
+MemorySerialPort::read(uint8_t* data, int size)
+{
+    int bytes;
+
+    // Waiting for a reply sends whatever the driver has combined
+    deliver();
+
+    bytes = min((uint32_t) size, _out.size() - _outPos);
+
+    memcpy(data, &_out[0] + _outPos, bytes);
+    _outPos += bytes;
+    if (_outPos == _out.size())
+    {
+        _out.clear();
+        _outPos = 0;
+    }
+
+    return bytes;
+}
+
+int
+MemorySerialPort::write(const uint8_t* data, int size)
+{
+    if (_usb && _bug == BUG_SEND_MERGE)
+        _packet.append((const char*) data, size);
+    else
+        receive(data, size);
+
+    return size;
+}
+
+void
+MemorySerialPort::deliver()
+{
+    std::string packet;
+
+    if (_packet.empty())
+        return;
+
+    packet.swap(_packet);
+    receive((const uint8_t*) packet.data(), packet.size());
+}
+
+void
+MemorySerialPort::receive(const uint8_t* data, int size)
+{
+    uint32_t bytes;
+    bool executed = false;
+    bool sent = false;
+    int pos = 0;
+
+    while (pos < size)
+    {
+        if (_xmodem == XMODEM_RECV)
+        {
+            pos += receiveXmodem(data + pos, size - pos);
+            continue;
+        }
+        if (_xmodem == XMODEM_SEND)
+        {
+            sendXmodem(data[pos++]);
+            continue;
+        }
+
+        // Data following a send command goes straight to memory unless
+        // the emulated firmware bug loses it
+        if (_sendBytes > 0)
+        {
+            bytes = min(_sendBytes, (uint32_t) (size - pos));
+            if (!(_bug == BUG_PACKET_MERGE && executed) &&
+                !(_bug == BUG_SEND_MERGE && sent))
+                writeMemory(_sendAddr, data + pos, bytes);
+            _sendAddr += bytes;
+            _sendBytes -= bytes;
+            pos += bytes;
+            continue;
+        }
+
+        if (data[pos] == '#')
+        {
+            if (!_cmd.empty() && !(_bug == BUG_PACKET_MERGE && executed))
+            {
+                execute();
+                executed = true;
+                sent = _cmd[0] == 'S';
+            }
+            _cmd.clear();
+        }
+        else if (_cmd.size() < 32)
+        {
+            _cmd += (char) data[pos];
+        }
+        pos++;
+    }
+}
+
+int
+MemorySerialPort::get()
+{
+    uint8_t byte;
+
+    if (read(&byte, 1) != 1)
+        return -1;
+
+    return byte;
+}
+
+int
+MemorySerialPort::put(int c)
+{
+    uint8_t byte = c;
+
+    return write(&byte, 1);
+}
+
+bool
+MemorySerialPort::timeout(int millisecs)
+{
+    return true;
+}
+
+void
+MemorySerialPort::flush()
+{
+    deliver();
+}
+
+void
+MemorySerialPort::reply(const uint8_t* data, uint32_t size)
+{
+    _out.insert(_out.end(), data, data + size);
+}
+
+void
+MemorySerialPort::execute()
+{
+    uint32_t addr = 0;
+    uint32_t value = 0;
+    uint8_t buf[4];
+    char* end;
+
+    if (_cmd.empty())
+        return;
+
+    if (_cmd.size() > 1)
+    {
+        addr = strtoul(_cmd.c_str() + 1, &end, 16);
+        if (*end == ',')
+            value = strtoul(end + 1, NULL, 16);
+    }
+
+    switch (_cmd[0])
+    {
+    case 'N':
+    case 'T':
+        reply((const uint8_t*) "\n\r", 2);
+        break;
+
+    case 'V':
+        reply((const uint8_t*) "v1.1 Offline Image\n\r", 20);
+        break;
+
+    case 'O':
+        buf[0] = value;
+        writeMemory(addr, buf, 1);
+        break;
+
+    case 'o':
+        readMemory(addr, buf, 1);
+        reply(buf, 1);
+        break;
+
+    case 'W':
+        writeWord(addr, value);
+        break;
+
+    case 'w':
+        readMemory(addr, buf, 4);
+        reply(buf, 4);
+        break;
+
+    case 'S':
+        _sendAddr = addr;
+        _sendBytes = value;
+        if (!_usb)
+        {
+            // The monitor asks for CRC blocks and the data arrives framed
+            _xmodem = XMODEM_RECV;
+            _block.clear();
+            buf[0] = START;
+            reply(buf, 1);
+        }
+        break;
+
+    case 'R':
+    {
+        std::vector<uint8_t> data(value);
+        if (value > 0)
+            readMemory(addr, &data[0], value);
+        if (!_usb)
+        {
+            // Blocks go out once the host asks for them
+            _xmodem = XMODEM_SEND;
+            _xmodemData = data;
+            _xmodemPos = 0;
+            _xmodemEot = false;
+        }
+        else if (value > 0)
+        {
+            reply(&data[0], value);
+        }
+        break;
+    }
+
+    case 'G':
+        go(addr);
+        break;
+
+    default:
+        break;
+    }
+}
+
+int
+MemorySerialPort::receiveXmodem(const uint8_t* data, int size)
+{
+    uint8_t control;
+    uint16_t crc16;
+    uint32_t bytes;
+    int used;
+
+    if (_block.empty() && data[0] == EOT)
+    {
+        _xmodem = XMODEM_NONE;
+        _sendBytes = 0;
+        control = ACK;
+        reply(&control, 1);
+        return 1;
+    }
+
+    used = min((int) (BLK_SIZE + 5 - _block.size()), size);
+    _block.insert(_block.end(), data, data + used);
+    if (_block.size() < BLK_SIZE + 5)
+        return used;
+
+    crc16 = _block[BLK_SIZE + 3] << 8 | _block[BLK_SIZE + 4];
+    if (_block[0] == SOH && Crc16::xmodem(&_block[3], BLK_SIZE) == crc16)
+    {
+        bytes = min((uint32_t) BLK_SIZE, _sendBytes);
+        writeMemory(_sendAddr, &_block[3], bytes);
+        _sendAddr += bytes;
+        _sendBytes -= bytes;
+        control = ACK;
+    }
+    else
+    {
+        control = NAK;
+    }
+    reply(&control, 1);
+    _block.clear();
+
+    return used;
+}
+
+void
+MemorySerialPort::sendXmodem(uint8_t control)
+{
+    uint8_t blk[BLK_SIZE + 5];
+    uint32_t bytes;
+    uint16_t crc16;
+
+    if (control == ACK)
+    {
+        if (_xmodemEot)
+        {
+            _xmodem = XMODEM_NONE;
+            return;
+        }
+        _xmodemPos += BLK_SIZE;
+    }
+    else if (control != START && control != NAK)
+    {
+        return;
+    }
+
+    if (_xmodemPos >= _xmodemData.size())
+    {
+        _xmodemEot = true;
+        blk[0] = EOT;
+        reply(blk, 1);
+        return;
+    }
+
+    bytes = min((uint32_t) BLK_SIZE, _xmodemData.size() - _xmodemPos);
+    blk[0] = SOH;
+    blk[1] = (_xmodemPos / BLK_SIZE + 1) & 0xff;
+    blk[2] = ~blk[1];
+    memcpy(&blk[3], &_xmodemData[_xmodemPos], bytes);
+    memset(&blk[3] + bytes, 0, BLK_SIZE - bytes);
+    crc16 = Crc16::xmodem(&blk[3], BLK_SIZE);
+    blk[BLK_SIZE + 3] = crc16 >> 8;
+    blk[BLK_SIZE + 4] = crc16 & 0xff;
+    reply(blk, sizeof(blk));
+}
+
+uint8_t*
+MemorySerialPort::page(uint32_t addr, bool create)
+{
+    PageMap::iterator it = _pages.find(addr / PAGE_SIZE);
+
+    if (it != _pages.end())
+        return &it->second[0];
+    if (!create)
+        return NULL;
+
+    std::vector<uint8_t>& data = _pages[addr / PAGE_SIZE];
+    data.resize(PAGE_SIZE, 0);
+    return &data[0];
+}
+
+void
+MemorySerialPort::readMemory(uint32_t addr, uint8_t* buffer, uint32_t size)
+{
+    uint32_t offset;
+    uint32_t bytes;
+    uint8_t* data;
+
+    // Unmapped memory reads as zero like an unclocked peripheral
+    while (size > 0)
+    {
+        offset = addr % PAGE_SIZE;
+        bytes = min(PAGE_SIZE - offset, size);
+        data = page(addr, false);
+        if (data)
+            memcpy(buffer, data + offset, bytes);
+        else
+            memset(buffer, 0, bytes);
+
+        addr += bytes;
+        buffer += bytes;
+        size -= bytes;
+    }
+}
+
+void
+MemorySerialPort::writeMemory(uint32_t addr, const uint8_t* buffer, uint32_t size)
+{
+    uint32_t offset;
+    uint32_t bytes;
+
+    while (size > 0)
+    {
+        offset = addr % PAGE_SIZE;
+        bytes = min(PAGE_SIZE - offset, size);
+        memcpy(page(addr, true) + offset, buffer, bytes);
+
+        addr += bytes;
+        buffer += bytes;
+        size -= bytes;
+    }
+}
+
+void
+MemorySerialPort::fillMemory(uint32_t addr, uint8_t value, uint32_t size)
+{
+    uint32_t offset;
+    uint32_t bytes;
+
+    while (size > 0)
+    {
+        offset = addr % PAGE_SIZE;
+        bytes = min(PAGE_SIZE - offset, size);
+        memset(page(addr, true) + offset, value, bytes);
+
+        addr += bytes;
+        size -= bytes;
+    }
+}
+
+void
+MemorySerialPort::writeWord(uint32_t addr, uint32_t value)
+{
+    uint8_t buf[4];
+
+    buf[0] = value;
+    buf[1] = value >> 8;
+    buf[2] = value >> 16;
+    buf[3] = value >> 24;
+    writeMemory(addr, buf, 4);
+}
+
+uint32_t
+MemorySerialPort::readWord(uint32_t addr)
+{
+    uint8_t buf[4];
+
+    readMemory(addr, buf, 4);
+    return buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24);
+}
+
+void
+MemorySerialPort::go(uint32_t addr)
+{
+    const BlankCheckArm& applet = BlankCheckApplet::applet;
+    std::vector<uint8_t> code(applet.signature);
+    uint32_t entry[2];
+
+    // ARM7 monitors jump to the Thumb entry point while Cortex-M ones
+    // take it from the reset word after a stack vector
+    entry[0] = addr & ~1;
+    entry[1] = readWord(addr + 4) & ~1;
+    for (int i = 0; i < 2; i++)
+    {
+        readMemory(entry[i] - applet.start, &code[0], code.size());
+        if (memcmp(&code[0], applet.code, code.size()) == 0)
+        {
+            blankCheck(entry[i] - applet.start);
+            return;
+        }
+    }
+}
+
+void
+MemorySerialPort::blankCheck(uint32_t base)
+{
+    const BlankCheckArm& applet = BlankCheckApplet::applet;
+    uint32_t src = readWord(base + applet.src_addr);
+    uint32_t dst = readWord(base + applet.dst_addr);
+    uint32_t words = readWord(base + applet.words);
+    uint32_t pages = readWord(base + applet.pages);
+    std::vector<uint8_t> data(words * sizeof(uint32_t));
+    uint32_t bitmap = 0;
+
+    // Same bitmap as the applet: a set bit for each page with any
+    // byte that is not erased, stored a word per 32 pages
+    for (uint32_t page = 0; page < pages; page++)
+    {
+        if (!data.empty())
+            readMemory(src, &data[0], data.size());
+        for (uint32_t i = 0; i < data.size(); i++)
+        {
+            if (data[i] != 0xff)
+            {
+                bitmap |= 1 << (page % 32);
+                break;
+            }
+        }
+        src += data.size();
+
+        if (page % 32 == 31 || page == pages - 1)
+        {
+            writeWord(dst, bitmap);
+            dst += sizeof(uint32_t);
+            bitmap = 0;
+        }
+    }
+}
+
+void
+MemorySerialPort::mapDevice(const Device& device)
+{
+    uint32_t pageBits = 0;
+
+    // Erased flash with the identification registers behind it
+    fillMemory(device.addr, 0xff, device.pages * device.size);
+    writeWord(CHIPID_CIDR_SAM7, device.chipId);
+    writeWord(CHIPID_CIDR_SAM3, device.chipId);
+
+    // The flash controllers always report ready and unlocked
+    writeWord(device.regs + 0x08, FSR_FRDY);
+    switch (device.type)
+    {
+    case Device::FLASH_EFC:
+        if (device.planes == 2)
+            writeWord(device.regs + 0x18, FSR_FRDY);
+        break;
+
+    case Device::FLASH_EEFC:
+        if (device.planes == 2)
+            writeWord(device.regs + 0x208, FSR_FRDY);
+        break;
+
+    case Device::FLASH_CALW:
+        while ((32U << pageBits) < device.size)
+            pageBits++;
+        writeWord(device.regs + 0x0c, pageBits << 8);
+        break;
+    }
+}
+
+void
+MemorySerialPort::load(const std::string& filename, uint32_t addr)
+{
+    std::vector<uint8_t> image;
+    uint8_t buf[4096];
+    size_t bytes;
+    FILE* infile;
+
+    infile = fopen(filename.c_str(), "rb");
+    if (!infile)
+        throw FileOpenError(errno);
+
+    while ((bytes = fread(buf, 1, sizeof(buf), infile)) > 0)
+        image.insert(image.end(), buf, buf + bytes);
+
+    if (ferror(infile))
+    {
+        int errnum = errno;
+        fclose(infile);
+        throw FileIoError(errnum);
+    }
+    fclose(infile);
+
+    if (image.size() >= 4 && memcmp(&image[0], "\x7f" "ELF", 4) == 0)
+        loadElf(image);
+    else if (!image.empty())
+        writeMemory(addr, &image[0], image.size());
+}
+
+static uint32_t
+elfWord(const std::vector<uint8_t>& image, uint32_t offset)
+{
+    // Offsets come from the file so the bounds are checked without
+    // adding to them, which could wrap
+    if (image.size() < 4 || offset > image.size() - 4)
+        throw ImageFormatError();
+
+    return image[offset] | (image[offset + 1] << 8) |
+           (image[offset + 2] << 16) | (image[offset + 3] << 24);
+}
+
+static uint16_t
+elfHalf(const std::vector<uint8_t>& image, uint32_t offset)
+{
+    if (image.size() < 2 || offset > image.size() - 2)
+        throw ImageFormatError();
+
+    return image[offset] | (image[offset + 1] << 8);
+}
+
+void
+MemorySerialPort::loadElf(const std::vector<uint8_t>& image)
+{
+    uint32_t phoff;
+    uint16_t phentsize;
+    uint16_t phnum;
+    uint32_t ph;
+    uint32_t offset;
+    uint32_t paddr;
+    uint32_t filesz;
+    uint32_t loaded = 0;
+
+    // Only 32-bit little endian ARM images are meaningful here
+    if (image.size() < 52 || image[4] != 1 || image[5] != 1 ||
+        elfHalf(image, 18) != ELF_EM_ARM)
+        throw ImageFormatError();
+
+    phoff = elfWord(image, 28);
+    phentsize = elfHalf(image, 42);
+    phnum = elfHalf(image, 44);
+    if (phentsize < 32 ||
+        (uint64_t) phoff + (uint64_t) phnum * phentsize > image.size())
+        throw ImageFormatError();
+
+    // Segments are placed at their load (physical) address which is
+    // where they live in flash even when they run from SRAM
+    for (uint16_t i = 0; i < phnum; i++)
+    {
+        ph = phoff + i * phentsize;
+        if (elfWord(image, ph) != ELF_PT_LOAD)
+            continue;
+
+        offset = elfWord(image, ph + 4);
+        paddr = elfWord(image, ph + 12);
+        filesz = elfWord(image, ph + 16);
+        if (filesz == 0)
+            continue;
+        if (offset > image.size() || filesz > image.size() - offset)
+            throw ImageFormatError();
+
+        writeMemory(paddr, &image[offset], filesz);
+        loaded++;
+    }
+
+    if (loaded == 0)
+        throw ImageFormatError();
+}
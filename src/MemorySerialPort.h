@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef _MEMORYSERIALPORT_H
+#define _MEMORYSERIALPORT_H
+
+#include <exception>
+#include <map>
+#include <vector>
+
+#include "SerialPort.h"
+#include "Device.h"
+
+class ImageFormatError : public std::exception
+{
+public:
+    ImageFormatError() : exception() {};
+    const char* what() const throw() { return "Invalid ELF image"; }
+};
+
+// A SAM-BA monitor emulated over a sparse memory map.  It speaks the binary
+// (USB) protocol so Samba and everything above it runs unchanged at memory
+// speed, or the UART protocol with XMODEM block transfers when created
+// with usb false.  Code is never executed, but "go" to the blank check
+// applet runs an equivalent of it so blank checks see the image.
+//
+// The USB monitor can also reproduce one of the SAM-BA firmware bugs.
+// For the send merge bug, writes are combined into one USB packet until
+// a flush or read, as drivers do, and S data that arrives in the same
+// packet as its command is lost.
+class MemorySerialPort : public SerialPort
+{
+public:
+    enum Bug
+    {
+        BUG_NONE,
+        BUG_PACKET_MERGE,   // Only the first command of each write runs
+        BUG_SEND_MERGE      // S data in the packet of its command is lost
+    };
+
+    MemorySerialPort(const std::string& name, bool usb = true);
+    virtual ~MemorySerialPort();
+
+    bool open(int baud = 115200,
+              int data = 8,
+              SerialPort::Parity parity = SerialPort::ParityNone,
+              SerialPort::StopBit stop = SerialPort::StopBitOne);
+    void close();
+
+    bool isUsb() { return _usb; };
+
+    int read(uint8_t* data, int size);
+    int write(const uint8_t* data, int size);
+    int get();
+    int put(int c);
+
+    bool timeout(int millisecs);
+    void flush();
+
+    void mapDevice(const Device& device);
+    void load(const std::string& filename, uint32_t addr);
+
+    void readMemory(uint32_t addr, uint8_t* buffer, uint32_t size);
+    void writeMemory(uint32_t addr, const uint8_t* buffer, uint32_t size);
+    void fillMemory(uint32_t addr, uint8_t value, uint32_t size);
+
+    void writeWord(uint32_t addr, uint32_t value);
+
+    void setBug(Bug bug) { _bug = bug; }
+
+    static const uint32_t PAGE_SIZE = 4096;
+
+private:
+    typedef std::map<uint32_t, std::vector<uint8_t> > PageMap;
+
+    enum XmodemState
+    {
+        XMODEM_NONE,
+        XMODEM_RECV,        // Receiving the blocks of a send command
+        XMODEM_SEND,        // Sending the blocks of a receive command
+    };
+
+    bool _usb;
+    Bug _bug;
+    PageMap _pages;
+    std::string _cmd;
+    std::string _packet;
+    std::vector<uint8_t> _out;
+    uint32_t _outPos;
+    uint32_t _sendAddr;
+    uint32_t _sendBytes;
+    XmodemState _xmodem;
+    std::vector<uint8_t> _block;
+    std::vector<uint8_t> _xmodemData;
+    uint32_t _xmodemPos;
+    bool _xmodemEot;
+
+    uint8_t* page(uint32_t addr, bool create);
+    void receive(const uint8_t* data, int size);
+    void deliver();
+    void execute();
+    void go(uint32_t addr);
+    void blankCheck(uint32_t base);
+    uint32_t readWord(uint32_t addr);
+    void reply(const uint8_t* data, uint32_t size);
+    int receiveXmodem(const uint8_t* data, int size);
+    void sendXmodem(uint8_t control);
+    void loadElf(const std::vector<uint8_t>& image);
+};
+
+#endif // _MEMORYSERIALPORT_H
@@ -24,6 +24,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <termios.h>
+#include <sys/uio.h>
 #include <errno.h>
 
 #include <string>
@@ -240,6 +241,23 @@ PosixSerialPort::write(const uint8_t* buffer, int len)
     return ::write(_devfd, buffer, len);
 }
 
+int
+PosixSerialPort::writev(const SerialBuffer* buffers, int count)
+{
+    struct iovec iov[count];
+
+    if (_devfd == -1)
+        return -1;
+
+    for (int i = 0; i < count; i++)
+    {
+        iov[i].iov_base = (void*) buffers[i].data;
+        iov[i].iov_len = buffers[i].size;
+    }
+
+    return ::writev(_devfd, iov, count);
+}
+
 int
 PosixSerialPort::get()
 {
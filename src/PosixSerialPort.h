@@ -37,6 +37,7 @@ public:
 
     int read(uint8_t* data, int size);
     int write(const uint8_t* data, int size);
+    int writev(const SerialBuffer* buffers, int count);
     int get();
     int put(int c);
 
@@ -17,6 +17,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ///////////////////////////////////////////////////////////////////////////////
 #include "Samba.h"
+#include "Crc16.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -36,11 +37,12 @@ using namespace std;
 #define START       'C'
 
 #define TIMEOUT_QUICK   100
+#define TIMEOUT_GAP     10
 #define TIMEOUT_NORMAL  1000
 
 #define min(a, b)   ((a) < (b) ? (a) : (b))
 
-Samba::Samba() : _debug(false), _isUsb(false)
+Samba::Samba() : _debug(false), _isUsb(false), _versionValid(false)
 {
 }
 
@@ -52,7 +54,6 @@ bool
 Samba::init()
 {
     uint8_t cmd[3];
-    uint32_t cid;
 
     _port->timeout(TIMEOUT_QUICK);
 
@@ -81,7 +82,8 @@ Samba::init()
     // Read the chip ID
     try
     {
-        cid = chipId();
+        identify();
+        findQuirks();
     }
     catch (SambaError)
     {
@@ -91,10 +93,10 @@ Samba::init()
     _port->timeout(TIMEOUT_NORMAL);
 
     if (_debug)
-        printf("chipId=%#08x\n", cid);
+        printf("chipId=%#08x\n", _info.chipId);
 
-    uint8_t eproc = (cid >> 5) & 0x7;
-    uint8_t arch = (cid >> 20) & 0xff;
+    uint8_t eproc = _info.eproc;
+    uint8_t arch = _info.arch;
 
     // Check for ARM7TDMI processor
     if (eproc == 2)
@@ -146,6 +148,8 @@ bool
 Samba::connect(SerialPort::Ptr port)
 {
     _port = port;
+    _info = ChipInfo();
+    _versionValid = false;
 
     // Try to connect at a high speed if USB
     _isUsb = _port->isUsb();
@@ -153,6 +157,7 @@ Samba::connect(SerialPort::Ptr port)
     {
         if (_debug)
             printf("Connected at 921600 baud\n");
+        _info.baud = 921600;
         return true;
     }
     _isUsb = false;
@@ -162,6 +167,7 @@ Samba::connect(SerialPort::Ptr port)
     {
         if (_debug)
             printf("Connected at 115200 baud\n");
+        _info.baud = 115200;
         return true;
     }
 
@@ -242,89 +248,33 @@ Samba::readWord(uint32_t addr)
     return value;
 }
 
-uint16_t
-Samba::crc16Calc(const uint8_t *data, int len)
-{
-    static const uint16_t crc16Table[256] = {
-        0x0000,0x1021,0x2042,0x3063,0x4084,0x50a5,0x60c6,0x70e7,
-        0x8108,0x9129,0xa14a,0xb16b,0xc18c,0xd1ad,0xe1ce,0xf1ef,
-        0x1231,0x0210,0x3273,0x2252,0x52b5,0x4294,0x72f7,0x62d6,
-        0x9339,0x8318,0xb37b,0xa35a,0xd3bd,0xc39c,0xf3ff,0xe3de,
-        0x2462,0x3443,0x0420,0x1401,0x64e6,0x74c7,0x44a4,0x5485,
-        0xa56a,0xb54b,0x8528,0x9509,0xe5ee,0xf5cf,0xc5ac,0xd58d,
-        0x3653,0x2672,0x1611,0x0630,0x76d7,0x66f6,0x5695,0x46b4,
-        0xb75b,0xa77a,0x9719,0x8738,0xf7df,0xe7fe,0xd79d,0xc7bc,
-        0x48c4,0x58e5,0x6886,0x78a7,0x0840,0x1861,0x2802,0x3823,
-        0xc9cc,0xd9ed,0xe98e,0xf9af,0x8948,0x9969,0xa90a,0xb92b,
-        0x5af5,0x4ad4,0x7ab7,0x6a96,0x1a71,0x0a50,0x3a33,0x2a12,
-        0xdbfd,0xcbdc,0xfbbf,0xeb9e,0x9b79,0x8b58,0xbb3b,0xab1a,
-        0x6ca6,0x7c87,0x4ce4,0x5cc5,0x2c22,0x3c03,0x0c60,0x1c41,
-        0xedae,0xfd8f,0xcdec,0xddcd,0xad2a,0xbd0b,0x8d68,0x9d49,
-        0x7e97,0x6eb6,0x5ed5,0x4ef4,0x3e13,0x2e32,0x1e51,0x0e70,
-        0xff9f,0xefbe,0xdfdd,0xcffc,0xbf1b,0xaf3a,0x9f59,0x8f78,
-        0x9188,0x81a9,0xb1ca,0xa1eb,0xd10c,0xc12d,0xf14e,0xe16f,
-        0x1080,0x00a1,0x30c2,0x20e3,0x5004,0x4025,0x7046,0x6067,
-        0x83b9,0x9398,0xa3fb,0xb3da,0xc33d,0xd31c,0xe37f,0xf35e,
-        0x02b1,0x1290,0x22f3,0x32d2,0x4235,0x5214,0x6277,0x7256,
-        0xb5ea,0xa5cb,0x95a8,0x8589,0xf56e,0xe54f,0xd52c,0xc50d,
-        0x34e2,0x24c3,0x14a0,0x0481,0x7466,0x6447,0x5424,0x4405,
-        0xa7db,0xb7fa,0x8799,0x97b8,0xe75f,0xf77e,0xc71d,0xd73c,
-        0x26d3,0x36f2,0x0691,0x16b0,0x6657,0x7676,0x4615,0x5634,
-        0xd94c,0xc96d,0xf90e,0xe92f,0x99c8,0x89e9,0xb98a,0xa9ab,
-        0x5844,0x4865,0x7806,0x6827,0x18c0,0x08e1,0x3882,0x28a3,
-        0xcb7d,0xdb5c,0xeb3f,0xfb1e,0x8bf9,0x9bd8,0xabbb,0xbb9a,
-        0x4a75,0x5a54,0x6a37,0x7a16,0x0af1,0x1ad0,0x2ab3,0x3a92,
-        0xfd2e,0xed0f,0xdd6c,0xcd4d,0xbdaa,0xad8b,0x9de8,0x8dc9,
-        0x7c26,0x6c07,0x5c64,0x4c45,0x3ca2,0x2c83,0x1ce0,0x0cc1,
-        0xef1f,0xff3e,0xcf5d,0xdf7c,0xaf9b,0xbfba,0x8fd9,0x9ff8,
-        0x6e17,0x7e36,0x4e55,0x5e74,0x2e93,0x3eb2,0x0ed1,0x1ef0
-    };
-    uint16_t crc16 = 0;
-
-    while (len-- > 0)
-        crc16 = (crc16 << 8) ^ crc16Table[((crc16 >> 8) ^ *(uint8_t*) data++) & 0xff];
-    return crc16;
-}
-
-bool
-Samba::crc16Check(const uint8_t *blk)
-{
-    uint16_t crc16;
-
-    crc16 = blk[BLK_SIZE + 3] << 8 | blk[BLK_SIZE + 4];
-    return (crc16Calc(&blk[3], BLK_SIZE) == crc16);
-}
-
-void
-Samba::crc16Add(uint8_t *blk)
-{
-    uint16_t crc16;
-
-    crc16 = crc16Calc(&blk[3], BLK_SIZE);
-    blk[BLK_SIZE + 3] = (crc16 >> 8) & 0xff;
-    blk[BLK_SIZE + 4] = crc16 & 0xff;
-}
-
 void
 Samba::readXmodem(uint8_t* buffer, int size)
 {
-    uint8_t blk[BLK_SIZE + 5];
+    uint8_t head[3];
+    uint8_t blk[BLK_SIZE];
+    uint8_t tail[2];
+    uint8_t* payload;
     uint32_t blkNum = 1;
     int retries;
-    int bytes;
 
     while (size > 0)
     {
+        // Full blocks land straight in the caller's buffer and only the
+        // last partial block is staged
+        payload = (size >= BLK_SIZE ? buffer : blk);
+
         for (retries = 0; retries < MAX_RETRIES; retries++)
         {
             if (blkNum == 1)
                 _port->put(START);
 
-            bytes = _port->read(blk, sizeof(blk));
-            if (bytes == sizeof(blk) &&
-                blk[0] == SOH &&
-                blk[1] == (blkNum & 0xff) &&
-                crc16Check(blk))
+            if (_port->read(head, sizeof(head)) == sizeof(head) &&
+                _port->read(payload, BLK_SIZE) == BLK_SIZE &&
+                _port->read(tail, sizeof(tail)) == sizeof(tail) &&
+                head[0] == SOH &&
+                head[1] == (blkNum & 0xff) &&
+                Crc16::xmodem(payload, BLK_SIZE) == (tail[0] << 8 | tail[1]))
                 break;
 
             if (blkNum != 1)
@@ -335,7 +285,8 @@ Samba::readXmodem(uint8_t* buffer, int size)
 
         _port->put(ACK);
 
-        memcpy(buffer, &blk[3], min(size, BLK_SIZE));
+        if (payload == blk)
+            memcpy(buffer, blk, size);
         buffer += BLK_SIZE;
         size -= BLK_SIZE;
         blkNum++;
@@ -357,7 +308,13 @@ Samba::readXmodem(uint8_t* buffer, int size)
 void
 Samba::writeXmodem(const uint8_t* buffer, int size)
 {
-    uint8_t blk[BLK_SIZE + 5];
+    uint8_t head[3];
+    uint8_t last[BLK_SIZE];
+    uint8_t tail[2];
+    SerialBuffer frame[3];
+    const uint8_t* payload;
+    const uint8_t* next;
+    uint16_t crc16;
     uint32_t blkNum = 1;
     int retries;
     int bytes;
@@ -370,22 +327,44 @@ Samba::writeXmodem(const uint8_t* buffer, int size)
     if (retries == MAX_RETRIES)
         throw SambaError();
 
+    // Only a final partial block is copied so it can be padded
+    if (size > 0 && size % BLK_SIZE != 0)
+    {
+        memcpy(last, buffer + size / BLK_SIZE * BLK_SIZE, size % BLK_SIZE);
+        memset(last + size % BLK_SIZE, 0, BLK_SIZE - size % BLK_SIZE);
+    }
+
+    payload = (size >= BLK_SIZE ? buffer : last);
+    crc16 = Crc16::xmodem(payload, BLK_SIZE);
+
     while (size > 0)
     {
-        blk[0] = SOH;
-        blk[1] = (blkNum & 0xff);
-        blk[2] = ~(blkNum & 0xff);
-        memcpy(&blk[3], buffer, min(size, BLK_SIZE));
-        if (size < BLK_SIZE)
-            memset(&blk[3] + size, 0, BLK_SIZE - size);
-        crc16Add(blk);
+        head[0] = SOH;
+        head[1] = (blkNum & 0xff);
+        head[2] = ~(blkNum & 0xff);
+        tail[0] = (crc16 >> 8) & 0xff;
+        tail[1] = crc16 & 0xff;
+
+        frame[0].data = head;
+        frame[0].size = sizeof(head);
+        frame[1].data = payload;
+        frame[1].size = BLK_SIZE;
+        frame[2].data = tail;
+        frame[2].size = sizeof(tail);
+
+        next = (size - BLK_SIZE >= BLK_SIZE ? buffer + BLK_SIZE : last);
 
         for (retries = 0; retries < MAX_RETRIES; retries++)
         {
-            bytes = _port->write(blk, sizeof(blk));
-            if (bytes != sizeof(blk))
+            bytes = _port->writev(frame, 3);
+            if (bytes != BLK_SIZE + 5)
                 throw SambaError();
 
+            // The next block's CRC is worked out while this one is still
+            // on the wire
+            if (retries == 0 && size > BLK_SIZE)
+                crc16 = Crc16::xmodem(next, BLK_SIZE);
+
             if (_port->get() == ACK)
                 break;
         }
@@ -395,6 +374,7 @@ Samba::writeXmodem(const uint8_t* buffer, int size)
 
         buffer += BLK_SIZE;
         size -= BLK_SIZE;
+        payload = next;
         blkNum++;
     }
 
@@ -433,7 +413,7 @@ Samba::read(uint32_t addr, uint8_t* buffer, int size)
     // The SAM firmware has a bug reading powers of 2 over 32 bytes
     // via USB.  If that is the case here, then read the first byte
     // with a readByte and then read one less than the requested size.
-    if (_isUsb && size > 32 && !(size & (size - 1)))
+    if ((_info.quirks & ChipInfo::QUIRK_READ_POW2) && size > 32 && !(size & (size - 1)))
     {
         *buffer = readByte(addr);
         addr++;
@@ -468,10 +448,12 @@ Samba::write(uint32_t addr, const uint8_t* buffer, int size)
     // gets confused.  Even though the writes are sperated in the code,
     // USB drivers often do write combining which can put them together
     // in the same USB data packet.  To avoid this, we call the serial
-    // port object's flush method before writing the data.
+    // port object's flush method before writing the data on monitors
+    // found to have the bug when connecting.
     if (_isUsb)
     {
-        _port->flush();
+        if (_info.quirks & ChipInfo::QUIRK_PACKET_MERGE)
+            _port->flush();
         writeBinary(buffer, size);
     }
     else
@@ -495,7 +477,7 @@ Samba::go(uint32_t addr)
     // The SAM firmware can get confused if another command is
     // received in the same USB data packet as the go command
     // so we flush after writing the command over USB.
-    if (_isUsb)
+    if (_info.quirks & ChipInfo::QUIRK_PACKET_MERGE)
         _port->flush();
 }
 
@@ -506,13 +488,34 @@ Samba::version()
     char* str;
     int size;
     int pos;
+    int terms = 0;
+    int c;
+
+    if (_versionValid)
+        return _info.version;
 
     cmd[0] = 'V';
     cmd[1] = '#';
     _port->write(cmd, 2);
 
+    // The reply length is unknown so read up to the "\n\r" line
+    // terminator instead of waiting for a read of the whole buffer to
+    // time out.  Once one terminator character is seen, only a short
+    // gap is allowed for the other.
     _port->timeout(TIMEOUT_QUICK);
-    size = _port->read(cmd, sizeof(cmd) - 1);
+    for (size = 0; size < (int) sizeof(cmd) - 1 && terms < 2; size++)
+    {
+        c = _port->get();
+        if (c < 0)
+            break;
+        cmd[size] = c;
+
+        if (c == '\n' || c == '\r')
+        {
+            terms++;
+            _port->timeout(TIMEOUT_GAP);
+        }
+    }
     _port->timeout(TIMEOUT_NORMAL);
     if (size <= 0)
         throw SambaError();
@@ -525,25 +528,65 @@ Samba::version()
     }
     str[pos] = '\0';
 
-    std::string ver(str);
+    _info.version = str;
+    _versionValid = true;
+
+    if (_debug)
+        printf("%s()=%s\n", __FUNCTION__, _info.version.c_str());
+
+    return _info.version;
+}
+
+const ChipInfo&
+Samba::info()
+{
+    version();
+    return _info;
+}
+
+void
+Samba::refresh()
+{
+    identify();
+    _versionValid = false;
+}
+
+void
+Samba::findQuirks()
+{
+    // No monitor version is known to be free of the USB firmware bugs,
+    // and probing for them would send the very command sequences that
+    // upset an affected monitor, so every USB connection gets all the
+    // workarounds.  The serial link carries XMODEM and has neither bug.
+    _info.quirks = 0;
+    if (_isUsb)
+        _info.quirks = ChipInfo::QUIRK_READ_POW2 | ChipInfo::QUIRK_PACKET_MERGE;
 
     if (_debug)
-        printf("%s()=%s\n", __FUNCTION__, ver.c_str());
+        printf("%s()=%#x\n", __FUNCTION__, _info.quirks);
+}
 
-    return ver;
+void
+Samba::identify()
+{
+    _info.chipId = readChipId();
+    _info.eproc = (_info.chipId >> 5) & 0x7;
+    _info.arch = (_info.chipId >> 20) & 0xff;
+    _info.isUsb = _isUsb;
 }
 
 uint32_t
-Samba::chipId()
+Samba::readChipId()
 {
     uint32_t vector;
     uint32_t cid;
 
     // Read the ARM reset vector
     vector = readWord(0x0);
+    _info.armVector = ((vector & 0xff000000) == 0xea000000);
 
     // If the vector is a ARM7TDMI branch, then assume Atmel SAM7 registers
-    if ((vector & 0xff000000) == 0xea000000)
+    if (_info.armVector)
         cid = readWord(0xfffff240);
     // Else use the Atmel SAM3 registers
     else {
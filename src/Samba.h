@@ -33,6 +33,29 @@ public:
     const char* what() const throw() { return "SAM-BA operation failed"; }
 };
 
+// Identity of the connected device read once when connecting
+class ChipInfo
+{
+public:
+    ChipInfo() : chipId(0), eproc(0), arch(0), armVector(false),
+                 isUsb(false), baud(0), quirks(0) {}
+
+    enum
+    {
+        QUIRK_READ_POW2    = (1 << 0),  // USB block reads of 2^n > 32 bytes fail
+        QUIRK_PACKET_MERGE = (1 << 1),  // Only one command per USB packet
+    };
+
+    uint32_t chipId;
+    uint8_t eproc;
+    uint8_t arch;
+    bool armVector;         // Reset vector is an ARM7TDMI branch
+    bool isUsb;
+    int baud;
+    uint32_t quirks;        // Monitor bugs worked around on this connection
+    std::string version;    // Monitor version, read on first use
+};
+
 class Samba
 {
 public:
@@ -55,22 +78,30 @@ public:
 
     std::string version();
 
-    uint32_t chipId();
+    uint32_t chipId() { return _info.chipId; }
+    const ChipInfo& info();
+    void refresh();
 
     void setDebug(bool debug) { _debug = debug; }
 
+    bool isUsb() { return _isUsb; }
+    uint8_t eproc() { return _info.eproc; }
+    uint32_t quirks() { return _info.quirks; }
+
     const SerialPort& getSerialPort() { return *_port; }
 
 private:
     bool _debug;
     bool _isUsb;
+    bool _versionValid;
+    ChipInfo _info;
     SerialPort::Ptr _port;
 
     bool init();
+    void identify();
+    void findQuirks();
+    uint32_t readChipId();
 
-    uint16_t crc16Calc(const uint8_t *data, int len);
-    bool crc16Check(const uint8_t *blk);
-    void crc16Add(uint8_t *blk);
     void writeXmodem(const uint8_t* buffer, int size);
     void readXmodem(uint8_t* buffer, int size);
 
@@ -23,6 +23,13 @@
 #include <memory>
 #include <stdint.h>
 
+// One piece of a gathered write
+struct SerialBuffer
+{
+    const uint8_t* data;
+    int size;
+};
+
 class SerialPort
 {
 public:
@@ -53,6 +60,23 @@ public:
 
     virtual int read(uint8_t* data, int size) = 0;
     virtual int write(const uint8_t* data, int size) = 0;
+    virtual int writev(const SerialBuffer* buffers, int count)
+    {
+        int total = 0;
+        int bytes;
+
+        // Ports that can gather override this with a single system call
+        for (int i = 0; i < count; i++)
+        {
+            bytes = write(buffers[i].data, buffers[i].size);
+            if (bytes < 0)
+                return -1;
+            total += bytes;
+            if (bytes != buffers[i].size)
+                break;
+        }
+        return total;
+    }
     virtual int get() = 0;
     virtual int put(int c) = 0;
 
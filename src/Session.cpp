@@ -0,0 +1,178 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+
+#include "Session.h"
+#include "PortFactory.h"
+#include "FlashFactory.h"
+
+Session::Session(FlasherObserver* observer)
+    : _observer(observer ? *observer : _quiet)
+{
+}
+
+Session::~Session()
+{
+    close();
+}
+
+void
+Session::open(const std::string& port)
+{
+    PortFactory portFactory;
+    std::string name;
+
+    close();
+
+    // An empty port name scans every port the way bossac does
+    if (!port.empty())
+    {
+        if (!_samba.connect(portFactory.create(port)))
+            throw SessionError("No device found on " + port);
+    }
+    else
+    {
+        for (name = portFactory.begin();
+             name != portFactory.end();
+             name = portFactory.next())
+        {
+            if (_samba.connect(portFactory.create(name)))
+                break;
+        }
+        if (name == portFactory.end())
+            throw SessionError("Auto scan for device failed");
+    }
+
+    attach();
+}
+
+void
+Session::open(SerialPort::Ptr port)
+{
+    close();
+
+    if (!_samba.connect(port))
+        throw SessionError("No device found");
+
+    attach();
+}
+
+void
+Session::attach()
+{
+    FlashFactory flashFactory;
+    char message[64];
+
+    _flash = flashFactory.create(_samba, _samba.chipId());
+    if (_flash.get() == NULL)
+    {
+        _samba.disconnect();
+        snprintf(message, sizeof(message), "Flash for chip ID %08x is not supported",
+                 _samba.chipId());
+        throw SessionError(message);
+    }
+
+    _flasher.reset(new Flasher(_flash, _observer));
+}
+
+void
+Session::close()
+{
+    if (!isOpen())
+        return;
+
+    _flasher.reset();
+    _flash.reset();
+    _samba.disconnect();
+}
+
+const ChipInfo&
+Session::identify()
+{
+    flash();
+    return _samba.info();
+}
+
+Flash&
+Session::flash()
+{
+    if (!isOpen())
+        throw SessionError("Session is not open");
+
+    return *_flash;
+}
+
+const std::string&
+Session::name()
+{
+    return flash().name();
+}
+
+uint32_t
+Session::flashSize()
+{
+    return flash().numPages() * flash().pageSize();
+}
+
+uint32_t
+Session::pageSize()
+{
+    return flash().pageSize();
+}
+
+void
+Session::checkRange(uint32_t offset, uint32_t size)
+{
+    if (offset % pageSize() != 0)
+        throw SessionError("Offset is not a multiple of the page size");
+    if (offset > flashSize() || size > flashSize() - offset)
+        throw SessionError("Range exceeds the flash size");
+}
+
+void
+Session::erase()
+{
+    // The flash is erased directly so that later writes still check for
+    // dirty pages instead of assuming the whole device stays blank
+    flash().eraseAll();
+}
+
+void
+Session::write(uint32_t offset, const uint8_t* data, uint32_t size)
+{
+    checkRange(offset, size);
+    _flasher->write(data, size, offset);
+}
+
+bool
+Session::verify(uint32_t offset, const uint8_t* data, uint32_t size,
+                uint32_t& byteErrors)
+{
+    uint32_t pageErrors;
+
+    checkRange(offset, size);
+    return _flasher->verify(data, size, offset, pageErrors, byteErrors);
+}
+
+void
+Session::read(uint32_t offset, uint8_t* data, uint32_t size)
+{
+    checkRange(offset, size);
+    _flasher->read(data, size, offset);
+}
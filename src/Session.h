@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef _SESSION_H
+#define _SESSION_H
+
+#include <string>
+#include <exception>
+#include <memory>
+
+#include "Samba.h"
+#include "Flash.h"
+#include "Flasher.h"
+#include "SerialPort.h"
+
+class SessionError : public std::exception
+{
+public:
+    SessionError(const std::string& message) : exception(), _message(message) {}
+    virtual ~SessionError() throw() {}
+    virtual const char* what() const throw() { return _message.c_str(); }
+private:
+    std::string _message;
+};
+
+// One connection to a device that stays open across operations so an
+// embedding application pays for port probing and applet upload once.
+// Sessions share no state and may drive different devices concurrently
+// from different threads.
+class Session
+{
+public:
+    // Used when no observer is given and by callers that want no output
+    class QuietObserver : public FlasherObserver
+    {
+    public:
+        void onStatus(const char* message, ...) {}
+        void onProgress(int num, int div) {}
+    };
+
+    Session(FlasherObserver* observer = NULL);
+    virtual ~Session();
+
+    void open(const std::string& port);
+    void open(SerialPort::Ptr port);
+    void close();
+    bool isOpen() { return _flash.get() != NULL; }
+
+    const ChipInfo& identify();
+    const std::string& name();
+    uint32_t flashSize();
+    uint32_t pageSize();
+
+    void erase();
+    void write(uint32_t offset, const uint8_t* data, uint32_t size);
+    bool verify(uint32_t offset, const uint8_t* data, uint32_t size,
+                uint32_t& byteErrors);
+    void read(uint32_t offset, uint8_t* data, uint32_t size);
+
+    Samba& samba() { return _samba; }
+    Flash& flash();
+
+private:
+    QuietObserver _quiet;
+    FlasherObserver& _observer;
+    Samba _samba;
+    Flash::Ptr _flash;
+    std::auto_ptr<Flasher> _flasher;
+
+    void attach();
+    void checkRange(uint32_t offset, uint32_t size);
+};
+
+#endif // _SESSION_H
@@ -25,13 +25,14 @@
 using namespace std;
 
 Shell::Shell() :
-    _exitFlag(false)
+    _exitFlag(false), _errorFlag(false)
 {
     Command::setShell(this);
 
     add(new CommandBod);
     add(new CommandBootf);
     add(new CommandBor);
+    add(new CommandCache);
     add(new CommandConnect);
     add(new CommandDebug);
     add(new CommandDisass);
@@ -41,6 +42,7 @@ Shell::Shell() :
     add(new CommandGo);
     add(new CommandHelp);
     add(new CommandHistory);
+    add(new CommandImage);
     add(new CommandLock);
     add(new CommandInfo);
     add(new CommandMrb);
@@ -103,14 +105,16 @@ Shell::find(const char* name)
     return command;
 }
 
-void
+bool
 Shell::invoke(char* argv[], int argc)
 {
     Command* command;
 
+    _errorFlag = false;
+
     command = find(argv[0]);
     if (!command)
-        return;
+        return false;
 
     try
     {
@@ -120,11 +124,15 @@ Shell::invoke(char* argv[], int argc)
     {
         printf("\n%s.\nPort is disconnected.\n", e.what());
         Command::disconnect();
+        _errorFlag = true;
     }
     catch (exception& e)
     {
         printf("\n%s.\n", e.what());
+        _errorFlag = true;
     }
+
+    return !_errorFlag;
 }
 
 void
@@ -31,18 +31,20 @@ public:
     virtual ~Shell();
     Shell();
 
-    void invoke(char* argv[], int argc);
+    bool invoke(char* argv[], int argc);
     void help();
     void usage(const char* name);
     void add(Command* command);
     Command* find(const char* name);
 
     bool& exitFlag() { return _exitFlag; }
+    bool& errorFlag() { return _errorFlag; }
 
 private:
     typedef std::list<Command*> CommandList;
     CommandList _commandList;
     bool _exitFlag;
+    bool _errorFlag;
 };
 
 #endif // _Shell_H
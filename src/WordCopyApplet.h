@@ -19,10 +19,10 @@
 #ifndef _WORDCOPYAPPLET_H
 #define _WORDCOPYAPPLET_H
 
-#include "Applet.h"
+#include "CopyApplet.h"
 #include "WordCopyArm.h"
 
-class WordCopyApplet : public Applet
+class WordCopyApplet : public CopyApplet
 {
 public:
     WordCopyApplet(Samba& samba, uint32_t addr);
@@ -1,4 +1,5 @@
     .global start
+    .global signature
     .global stack
     .global reset
     .global dst_addr
@@ -35,6 +36,9 @@ return:
     bx      lr
 
     .align  0
+@ Written by the host to recognize a resident copy of the applet
+signature:
+    .word   0
 stack:
     .word   0
 reset:
@@ -4,22 +4,24 @@
 
 WordCopyArm WordCopyApplet::applet = {
 // dst_addr
-0x00000028,
+0x0000002c,
 // reset
-0x00000024,
+0x00000028,
+// signature
+0x00000020,
 // src_addr
-0x0000002c,
+0x00000030,
 // stack
-0x00000020,
+0x00000024,
 // start
 0x00000000,
 // words
-0x00000030,
+0x00000034,
 // code
 {
-0x09, 0x48, 0x0a, 0x49, 0x0a, 0x4a, 0x02, 0xe0, 0x08, 0xc9, 0x08, 0xc0, 0x01, 0x3a, 0x00, 0x2a,
-0xfa, 0xd1, 0x04, 0x48, 0x00, 0x28, 0x01, 0xd1, 0x01, 0x48, 0x85, 0x46, 0x70, 0x47, 0xc0, 0x46,
+0x0a, 0x48, 0x0b, 0x49, 0x0b, 0x4a, 0x02, 0xe0, 0x08, 0xc9, 0x08, 0xc0, 0x01, 0x3a, 0x00, 0x2a,
+0xfa, 0xd1, 0x05, 0x48, 0x00, 0x28, 0x01, 0xd1, 0x02, 0x48, 0x85, 0x46, 0x70, 0x47, 0xc0, 0x46,
 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 }
 };
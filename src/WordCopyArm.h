@@ -8,11 +8,12 @@ typedef struct
 {
     uint32_t dst_addr;
     uint32_t reset;
+    uint32_t signature;
     uint32_t src_addr;
     uint32_t stack;
     uint32_t start;
     uint32_t words;
-    uint8_t code[52];
+    uint8_t code[56];
 } WordCopyArm;
 
 #endif // _WORDCOPYARM_H
@@ -4309,25 +4309,65 @@ arm_dis_print_address (bfd_vma addr, struct disassemble_info *info)
     info->fprintf_func(info->stream, "%#lx", addr);
 }
 
+/* Output is collected in a buffer and written in large blocks since
+   each instruction is printed as many small pieces.  */
+struct arm_dis_sink
+{
+  FILE *file;
+  size_t used;
+  char buf[16384];
+};
+
+static void
+arm_dis_flush (struct arm_dis_sink *sink)
+{
+  if (sink->used > 0)
+    fwrite (sink->buf, 1, sink->used, sink->file);
+  sink->used = 0;
+}
+
 static int
 arm_dis_fprintf (void *stream, const char *format, ...)
 {
+  struct arm_dis_sink *sink = (struct arm_dis_sink *) stream;
+  size_t avail;
   va_list ap;
   int rc;
 
+  if (sizeof (sink->buf) - sink->used < 256)
+    arm_dis_flush (sink);
+  avail = sizeof (sink->buf) - sink->used;
+
   va_start(ap, format);
-  rc = vfprintf((FILE *)stream, format, ap);
+  rc = vsnprintf(sink->buf + sink->used, avail, format, ap);
+  va_end(ap);
+
+  if (rc < 0)
+    return rc;
+
+  if ((size_t) rc < avail)
+    {
+      sink->used += rc;
+      return rc;
+    }
+
+  /* Too long for the buffer so write it directly */
+  arm_dis_flush (sink);
+  va_start(ap, format);
+  rc = vfprintf(sink->file, format, ap);
   va_end(ap);
 
   return rc;
 }
 
 int
-arm_dis_buf(unsigned char *b, int len, bfd_vma pc, int is_thumb, int little_code)
+arm_dis_buf(unsigned char *b, int len, bfd_vma pc, int is_thumb, int little_code,
+            FILE *file)
 {
   struct arm_private_data priv_data;
   struct disassemble_info dis_info;
   struct disassemble_info *info = &dis_info;
+  struct arm_dis_sink sink;
   int  size = 4;
   long          given;
   void          (*printer) (bfd_vma, struct disassemble_info *, long);
@@ -4335,8 +4375,11 @@ arm_dis_buf(unsigned char *b, int len, bfd_vma pc, int is_thumb, int little_code
   memset(&priv_data, 0, sizeof(priv_data));
   priv_data.features.core = -1;
 
+  sink.file = file;
+  sink.used = 0;
+
   memset(&dis_info, 0, sizeof(dis_info));
-  dis_info.stream = stdout;
+  dis_info.stream = &sink;
   dis_info.print_address_func = arm_dis_print_address;
   dis_info.fprintf_func = arm_dis_fprintf;
   dis_info.private_data = &priv_data;
@@ -4412,6 +4455,8 @@ arm_dis_buf(unsigned char *b, int len, bfd_vma pc, int is_thumb, int little_code
         pc += size;
     }
 
+    arm_dis_flush (&sink);
+
     return len;
 }
 
@@ -1,10 +1,13 @@
 #ifndef _ARM_DIS_H
 #define _ARM_DIS_H
 
+#include <stdio.h>
 #include <bfd.h>
 
+// Returns the count of trailing bytes too short for an instruction
 int
-arm_dis_buf(unsigned char *b, int len, bfd_vma pc, int is_thumb, int little_code);
+arm_dis_buf(unsigned char *b, int len, bfd_vma pc, int is_thumb, int little_code,
+            FILE *file = stdout);
 
 #endif // _ARM_DIS_H
 
@@ -0,0 +1,508 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#include <string>
+#include <vector>
+#include <exception>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "CmdOpts.h"
+#include "Session.h"
+#include "PortFactory.h"
+#include "FlashFactory.h"
+#include "MemorySerialPort.h"
+#include "BenchSerialPort.h"
+
+using namespace std;
+
+// Links modeled on top of whatever port the benchmark runs against
+class LinkProfile
+{
+public:
+    const char* name;
+    int baud;
+    int latencyUs;
+    const char* help;
+};
+
+static const LinkProfile profiles[] =
+{
+    { "mem",      0,        0,    "no link cost, host overhead only" },
+    { "usb",      10000000, 1000, "USB full speed CDC, 1ms per turnaround" },
+    { "uart921k", 921600,   1000, "921600 baud through a USB serial adapter" },
+    { "uart115k", 115200,   1000, "115200 baud through a USB serial adapter" },
+};
+
+class BenchConfig
+{
+public:
+    BenchConfig();
+    virtual ~BenchConfig() {}
+
+    bool port;
+    bool chip;
+    bool uart;
+    bool sizes;
+    bool links;
+    bool count;
+    bool output;
+    bool help;
+
+    string portArg;
+    int chipArg;
+    string sizesArg;
+    string linksArg;
+    int countArg;
+    string outputArg;
+};
+
+BenchConfig::BenchConfig()
+{
+    port = false;
+    chip = false;
+    uart = false;
+    sizes = false;
+    links = false;
+    count = false;
+    output = false;
+    help = false;
+
+    chipArg = 0x28900960;
+    sizesArg = "4096,65536,full";
+    linksArg = "mem,usb,uart921k,uart115k";
+    countArg = 100;
+}
+
+static BenchConfig config;
+static Option opts[] =
+{
+    {
+      'p', "port", &config.port,
+      { ArgRequired, ArgString, "PORT", { &config.portArg } },
+      "run against the device on serial PORT;\n"
+      "THE DEVICE FLASH IS ERASED AND OVERWRITTEN;\n"
+      "default is an emulated device"
+    },
+    {
+      'c', "chip", &config.chip,
+      { ArgRequired, ArgInt, "CHIPID", { &config.chipArg } },
+      "chip ID of the emulated device [0x28900960]"
+    },
+    {
+      'u', "uart", &config.uart,
+      { ArgNone },
+      "emulate the UART monitor with XMODEM transfers\n"
+      "instead of the USB monitor"
+    },
+    {
+      's', "sizes", &config.sizes,
+      { ArgRequired, ArgString, "LIST", { &config.sizesArg } },
+      "comma-separated transfer sizes in bytes or 'full'\n"
+      "for the whole flash [4096,65536,full]"
+    },
+    {
+      'l', "links", &config.links,
+      { ArgRequired, ArgString, "LIST", { &config.linksArg } },
+      "comma-separated link profiles to model [all]"
+    },
+    {
+      'n', "count", &config.count,
+      { ArgRequired, ArgInt, "COUNT", { &config.countArg } },
+      "repetitions of each shell command [100]"
+    },
+    {
+      'o', "output", &config.output,
+      { ArgRequired, ArgString, "FILE", { &config.outputArg } },
+      "also write the results to FILE as CSV"
+    },
+    {
+      'h', "help", &config.help,
+      { ArgNone },
+      "display this help text"
+    }
+};
+
+class Bench
+{
+public:
+    Bench(const LinkProfile& profile, FILE* csv);
+    virtual ~Bench() {}
+
+    void run(const vector<string>& sizes);
+
+private:
+    const LinkProfile& _profile;
+    FILE* _csv;
+    Session _session;
+    BenchSerialPort* _link;
+    struct timeval _start;
+
+    void connect();
+    void info();
+    void shell();
+    void transfer(uint32_t size);
+
+    void begin();
+    void end(const char* scenario, uint32_t size, uint32_t count);
+};
+
+static void
+header(FILE* csv)
+{
+    printf("%-11s %-9s %8s %6s %10s %10s %9s %8s %7s %8s %8s\n",
+           "Scenario", "Link", "Size", "Count", "Wall(ms)", "Link(ms)",
+           "KB/s", "Trips", "Trips/n", "Calls", "Calls/KB");
+    if (csv)
+        fprintf(csv, "scenario,link,size,count,wall_us,link_us,kbps,"
+                "round_trips,round_trips_per_count,syscalls,syscalls_per_kb,"
+                "bytes_out,bytes_in,flushes\n");
+}
+
+Bench::Bench(const LinkProfile& profile, FILE* csv)
+    : _profile(profile), _csv(csv), _link(NULL)
+{
+}
+
+void
+Bench::begin()
+{
+    _link->reset();
+    gettimeofday(&_start, NULL);
+}
+
+// Reports one scenario.  Count is the number of pages moved by a
+// transfer or the number of repetitions of any other scenario, and the
+// per count figures are divided by it.
+void
+Bench::end(const char* scenario, uint32_t size, uint32_t count)
+{
+    struct timeval now;
+    const BenchCounters& counters = _link->counters();
+    double wallUs;
+    double totalUs;
+    double kbps = 0;
+    double tripsPer;
+    double callsPerKb;
+
+    gettimeofday(&now, NULL);
+    wallUs = (now.tv_sec - _start.tv_sec) * 1e6 + (now.tv_usec - _start.tv_usec);
+    totalUs = wallUs + counters.linkUs;
+
+    if (size > 0 && totalUs > 0)
+        kbps = size / 1024.0 / (totalUs / 1e6);
+    tripsPer = (double) counters.roundTrips / count;
+    // Without a payload the calls are spread over the link traffic instead
+    if (size > 0)
+        callsPerKb = counters.syscalls / (size / 1024.0);
+    else
+        callsPerKb = counters.syscalls /
+                     ((counters.bytesIn + counters.bytesOut) / 1024.0);
+
+    printf("%-11s %-9s %8u %6u %10.2f %10.2f %9.1f %8llu %7.2f %8llu %8.2f\n",
+           scenario, _profile.name, size, count, wallUs / 1000,
+           counters.linkUs / 1000, kbps,
+           (unsigned long long) counters.roundTrips, tripsPer,
+           (unsigned long long) counters.syscalls, callsPerKb);
+    if (_csv)
+        fprintf(_csv, "%s,%s,%u,%u,%.0f,%.0f,%.1f,%llu,%.3f,%llu,%.3f,%llu,%llu,%llu\n",
+                scenario, _profile.name, size, count, wallUs, counters.linkUs,
+                kbps, (unsigned long long) counters.roundTrips, tripsPer,
+                (unsigned long long) counters.syscalls, callsPerKb,
+                (unsigned long long) counters.bytesOut,
+                (unsigned long long) counters.bytesIn,
+                (unsigned long long) counters.flushes);
+}
+
+void
+Bench::connect()
+{
+    FlashFactory flashFactory;
+    PortFactory portFactory;
+    const Device* dev;
+    MemorySerialPort* image;
+    SerialPort::Ptr port;
+
+    if (config.port)
+    {
+        port = portFactory.create(config.portArg);
+    }
+    else
+    {
+        dev = flashFactory.device(config.chipArg);
+        if (!dev)
+            throw SessionError("Emulated chip ID is not supported");
+        image = new MemorySerialPort("emulator", !config.uart);
+        port.reset(image);
+        image->mapDevice(*dev);
+    }
+
+    _link = new BenchSerialPort(port, _profile.baud, _profile.latencyUs);
+    SerialPort::Ptr link(_link);
+
+    begin();
+    _session.open(link);
+    end("connect", 0, 1);
+
+    // The emulated flash is ready at once, so waiting out the device's
+    // programming times would swamp the host overhead being measured
+    if (!config.port)
+        _session.flash().setTimeouts(0, 0);
+}
+
+void
+Bench::info()
+{
+    Flash& flash = _session.flash();
+    std::vector<bool> regions;
+    std::vector<bool> dirty;
+
+    // The same queries as bossac --info
+    begin();
+    _session.samba().refresh();
+    _session.samba().info();
+    flash.getLockRegions(regions);
+    flash.checkBlank(0, flash.numPages(), dirty);
+    flash.getSecurity();
+    if (flash.canBootFlash())
+        flash.getBootFlash();
+    if (flash.canBod())
+        flash.getBod();
+    if (flash.canBor())
+        flash.getBor();
+    end("info", 0, 1);
+}
+
+void
+Bench::shell()
+{
+    Samba& samba = _session.samba();
+    uint32_t addr = _session.flash().address();
+    uint8_t buffer[256];
+
+    // The single word and small block accesses behind bossash mrw, mww,
+    // mrb and version.  Words written to the flash only reach its latch
+    // buffer and are replaced by the next page write.
+    begin();
+    for (int i = 0; i < config.countArg; i++)
+        samba.readWord(addr);
+    end("mrw", 0, config.countArg);
+
+    begin();
+    for (int i = 0; i < config.countArg; i++)
+        samba.writeWord(addr, i);
+    end("mww", 0, config.countArg);
+
+    begin();
+    for (int i = 0; i < config.countArg; i++)
+        samba.read(addr, buffer, sizeof(buffer));
+    end("mrb", 0, config.countArg);
+
+    begin();
+    for (int i = 0; i < config.countArg; i++)
+    {
+        samba.refresh();
+        samba.version();
+    }
+    end("version", 0, config.countArg);
+}
+
+void
+Bench::transfer(uint32_t size)
+{
+    vector<uint8_t> data(size);
+    vector<uint8_t> buffer(size);
+    uint32_t pages = (size + _session.pageSize() - 1) / _session.pageSize();
+    uint32_t byteErrors;
+    bool verified;
+
+    srand(size);
+    for (uint32_t i = 0; i < size; i++)
+        data[i] = rand();
+
+    begin();
+    _session.write(0, &data[0], size);
+    end("write", size, pages);
+
+    begin();
+    _session.erase();
+    _session.write(0, &data[0], size);
+    end("erase+write", size, pages);
+
+    begin();
+    verified = _session.verify(0, &data[0], size, byteErrors);
+    end("verify", size, pages);
+
+    // The emulator never runs the copy applet so its flash stays blank
+    if (config.port && !verified)
+        fprintf(stderr, "Verify of %u bytes failed with %u byte errors\n",
+                size, byteErrors);
+
+    begin();
+    _session.read(0, &buffer[0], size);
+    end("read", size, pages);
+}
+
+void
+Bench::run(const vector<string>& sizes)
+{
+    uint32_t size;
+    char* end;
+
+    connect();
+    info();
+    shell();
+
+    for (uint32_t i = 0; i < sizes.size(); i++)
+    {
+        if (sizes[i] == "full")
+        {
+            size = _session.flashSize();
+        }
+        else
+        {
+            size = strtoul(sizes[i].c_str(), &end, 0);
+            if (*end != '\0' || size == 0)
+                throw SessionError("Invalid size " + sizes[i]);
+        }
+
+        if (size > _session.flashSize())
+            throw SessionError("Size " + sizes[i] + " exceeds the flash size");
+
+        transfer(size);
+    }
+
+    _session.close();
+}
+
+static void
+split(const string& list, vector<string>& items)
+{
+    string::size_type start = 0;
+    string::size_type comma;
+
+    items.clear();
+    do
+    {
+        comma = list.find(',', start);
+        items.push_back(list.substr(start, comma - start));
+        start = comma + 1;
+    } while (comma != string::npos);
+}
+
+static int
+help(const char* program)
+{
+    fprintf(stderr, "Try '%s -h' or '%s --help' for more information\n", program, program);
+    return 1;
+}
+
+int
+main(int argc, char* argv[])
+{
+    int args;
+    char* pos;
+    CmdOpts cmd(argc, argv, sizeof(opts) / sizeof(opts[0]), opts);
+    vector<string> sizes;
+    vector<string> links;
+    vector<const LinkProfile*> selected;
+    const LinkProfile* profile;
+    FILE* csv = NULL;
+
+    if ((pos = strrchr(argv[0], '/')) || (pos = strrchr(argv[0], '\\')))
+        argv[0] = pos + 1;
+
+    args = cmd.parse();
+    if (args < 0)
+        return help(argv[0]);
+    if (args != argc)
+    {
+        fprintf(stderr, "%s: extra arguments found\n", argv[0]);
+        return help(argv[0]);
+    }
+
+    if (config.help)
+    {
+        printf("Usage: %s [OPTION...]\n", argv[0]);
+        printf("Benchmark of BOSSA connect, info, write, verify, read and shell\n"
+               "commands.  Wall time is measured and the link time of each profile\n"
+               "is modeled from the counted traffic; KB/s uses their sum.\n");
+        printf("\nOptions:\n");
+        cmd.usage(stdout);
+        printf("\nLink profiles:\n");
+        for (uint32_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++)
+            printf("  %-10s %s\n", profiles[i].name, profiles[i].help);
+        return 1;
+    }
+
+    if (config.countArg <= 0)
+    {
+        fprintf(stderr, "%s: count must be positive\n", argv[0]);
+        return help(argv[0]);
+    }
+
+    split(config.sizesArg, sizes);
+    split(config.linksArg, links);
+
+    for (uint32_t i = 0; i < links.size(); i++)
+    {
+        profile = NULL;
+        for (uint32_t j = 0; j < sizeof(profiles) / sizeof(profiles[0]); j++)
+            if (links[i] == profiles[j].name)
+                profile = &profiles[j];
+        if (!profile)
+        {
+            fprintf(stderr, "%s: unknown link profile %s\n", argv[0], links[i].c_str());
+            return help(argv[0]);
+        }
+        selected.push_back(profile);
+    }
+
+    if (config.output)
+    {
+        csv = fopen(config.outputArg.c_str(), "w");
+        if (!csv)
+        {
+            fprintf(stderr, "%s: unable to open %s\n", argv[0], config.outputArg.c_str());
+            return 1;
+        }
+    }
+
+    try
+    {
+        header(csv);
+        for (uint32_t i = 0; i < selected.size(); i++)
+        {
+            Bench bench(*selected[i], csv);
+            bench.run(sizes);
+        }
+    }
+    catch (exception& e)
+    {
+        fprintf(stderr, "\n%s\n", e.what());
+        if (csv)
+            fclose(csv);
+        return 1;
+    }
+
+    if (csv)
+        fclose(csv);
+    return 0;
+}
@@ -53,6 +53,7 @@ public:
     bool offset;
     bool userpage;
     bool applyAll;
+    bool stats;
 
     int readArg;
     string portArg;
@@ -81,6 +82,7 @@ BossaConfig::BossaConfig()
     offset = false;
     userpage = false;
     applyAll = false;
+    stats = false;
 
     readArg = 0;
     bootArg = 1;
@@ -177,6 +179,11 @@ static Option opts[] =
       { ArgNone },
       "display device information"
     },
+    {
+      'S', "stats", &config.stats,
+      { ArgNone },
+      "display the measured flash command timings"
+    },
     {
       'd', "debug", &config.debug,
       { ArgNone },
@@ -377,7 +384,8 @@ int apply_operations(Samba &samba, char* filename)
         return 1;
     }
 
-    Flasher flasher(flash);
+    FlasherConsole console;
+    Flasher flasher(flash, console);
 
     if (config.unlock)
         flasher.lock(config.unlockArg, false);
@@ -424,5 +432,8 @@ int apply_operations(Samba &samba, char* filename)
 
     if (config.info)
         flasher.info(samba);
+
+    if (config.stats)
+        flasher.stats();
     return 0;
 }
@@ -0,0 +1,176 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#include <string>
+#include <exception>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <signal.h>
+
+#include "CmdOpts.h"
+#include "Daemon.h"
+
+using namespace std;
+
+class BossadConfig
+{
+public:
+    BossadConfig();
+    virtual ~BossadConfig() {}
+
+    bool socket;
+    bool port;
+    bool help;
+
+    string socketArg;
+    string portArg;
+};
+
+BossadConfig::BossadConfig()
+{
+    socket = false;
+    port = false;
+    help = false;
+}
+
+static BossadConfig config;
+static Option opts[] =
+{
+    {
+      's', "socket", &config.socket,
+      { ArgRequired, ArgString, "PATH", { &config.socketArg } },
+      "listen for jobs on the Unix socket PATH;\n"
+      "default is bossad.sock in $XDG_RUNTIME_DIR"
+    },
+    {
+      'p', "port", &config.port,
+      { ArgRequired, ArgString, "PORTS", { &config.portArg } },
+      "serve the comma-separated serial PORTS;\n"
+      "jobs may only use these ports"
+    },
+    {
+      'h', "help", &config.help,
+      { ArgNone },
+      "display this help text"
+    }
+};
+
+static Daemon* daemonPtr;
+
+static void
+stopHandler(int signum)
+{
+    if (daemonPtr)
+        daemonPtr->stop();
+}
+
+int
+main(int argc, char* argv[])
+{
+    int args;
+    char* pos;
+    struct sigaction action;
+    size_t start;
+    size_t delim;
+    CmdOpts cmd(argc, argv, sizeof(opts) / sizeof(opts[0]), opts);
+
+    if ((pos = strrchr(argv[0], '/')) || (pos = strrchr(argv[0], '\\')))
+        argv[0] = pos + 1;
+
+    args = cmd.parse();
+    if (args < 0 || args != argc)
+    {
+        fprintf(stderr, "Try '%s -h' or '%s --help' for more information\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    if (config.help)
+    {
+        printf("Usage: %s [OPTION...]\n", argv[0]);
+        printf("Basic Open Source SAM-BA Application (BOSSA) Daemon\n"
+               "Version " VERSION "\n"
+               "\n"
+               "Clients send one request line per connection:\n"
+               "  job port=PORT ops=[ewvr] [offset=N] [file=PATH | size=N] [read=N]\n"
+               "  ports\n"
+               "PORT may be \"any\" to use the least busy configured port.  With size=N,\n"
+               "N image bytes follow the request line.  Replies are lines of\n"
+               "queued, status, progress and data followed by ok or error.\n"
+              );
+        printf("\nOptions:\n");
+        cmd.usage(stdout);
+        return 1;
+    }
+
+    if (!config.port)
+    {
+        fprintf(stderr, "%s: no ports given with -p\n", argv[0]);
+        return 1;
+    }
+
+    // A shared directory such as /tmp would let other users take the
+    // socket path, so only the per-user runtime directory is a default
+    if (!config.socket)
+    {
+        const char* runtime = getenv("XDG_RUNTIME_DIR");
+
+        if (!runtime || !*runtime)
+        {
+            fprintf(stderr, "%s: XDG_RUNTIME_DIR is not set, give a socket with -s\n", argv[0]);
+            return 1;
+        }
+        config.socketArg = string(runtime) + "/bossad.sock";
+    }
+
+    // Client disconnects show up as write errors instead of signals
+    signal(SIGPIPE, SIG_IGN);
+
+    // No SA_RESTART so that accept() returns and the daemon can exit
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stopHandler;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    try
+    {
+        Daemon daemon(config.socketArg);
+
+        daemonPtr = &daemon;
+        start = 0;
+        do
+        {
+            delim = config.portArg.find(',', start);
+            daemon.addPort(config.portArg.substr(start, delim - start));
+            start = delim + 1;
+        } while (delim != string::npos);
+
+        printf("Listening on %s\n", config.socketArg.c_str());
+        fflush(stdout);
+        daemon.serve();
+        daemonPtr = NULL;
+    }
+    catch (exception& e)
+    {
+        daemonPtr = NULL;
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
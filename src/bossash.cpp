@@ -18,21 +18,84 @@
 ///////////////////////////////////////////////////////////////////////////////
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
 #include <exception>
 #include <readline/readline.h>
 #include <readline/history.h>
 
 #include "Shell.h"
+#include "CmdOpts.h"
 
-#define ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
+using namespace std;
 
-static int
-split(char* str, char* tokv[], int tokn)
+class BossashConfig
 {
-    int tokc;
+public:
+    BossashConfig();
+    virtual ~BossashConfig() {}
 
-    for (tokc = 0; tokc < tokn - 1; tokc++)
+    bool file;
+    bool command;
+    bool keepGoing;
+    bool time;
+    bool help;
+
+    string fileArg;
+    string commandArg;
+};
+
+BossashConfig::BossashConfig()
+{
+    file = false;
+    command = false;
+    keepGoing = false;
+    time = false;
+    help = false;
+}
+
+static BossashConfig config;
+static Option opts[] =
+{
+    {
+      'f', "file", &config.file,
+      { ArgRequired, ArgString, "FILE", { &config.fileArg } },
+      "run the commands in FILE and exit;\n"
+      "read standard input if FILE is -"
+    },
+    {
+      'c', "command", &config.command,
+      { ArgRequired, ArgString, "CMDS", { &config.commandArg } },
+      "run the semicolon-separated CMDS and exit;\n"
+      "runs before any FILE commands"
+    },
+    {
+      'k', "keep-going", &config.keepGoing,
+      { ArgNone },
+      "continue with the next command after an error;\n"
+      "stop at the first error by default"
+    },
+    {
+      't', "time", &config.time,
+      { ArgNone },
+      "report the time taken by each command"
+    },
+    {
+      'h', "help", &config.help,
+      { ArgNone },
+      "display this help text"
+    }
+};
+
+static void
+split(char* str, vector<char*>& tokv)
+{
+    tokv.clear();
+
+    for (;;)
     {
         while (*str && isspace(*str))
             str++;
@@ -40,7 +103,7 @@ split(char* str, char* tokv[], int tokn)
         if (!*str)
             break;
 
-        tokv[tokc] = str;
+        tokv.push_back(str);
 
         while (*str && !isspace(*str))
             str++;
@@ -48,20 +111,95 @@ split(char* str, char* tokv[], int tokn)
         if (*str)
             *str++ = '\0';
     }
+}
+
+static bool
+invoke(Shell& shell, char* str)
+{
+    vector<char*> tokv;
+    struct timeval start;
+    struct timeval end;
+    long usecs;
+    bool result;
+
+    split(str, tokv);
+    if (tokv.empty())
+        return true;
+
+    gettimeofday(&start, NULL);
+    result = shell.invoke(&tokv[0], tokv.size());
+    gettimeofday(&end, NULL);
+
+    if (config.time)
+    {
+        usecs = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_usec - start.tv_usec);
+        printf("[%s: %ld.%03ld ms]\n", tokv[0], usecs / 1000, usecs % 1000);
+    }
+
+    return result;
+}
+
+// Run each command of a line in turn.  Returns false if a command
+// failed and the session should stop.
+static bool
+runLine(Shell& shell, char* line, bool& failed)
+{
+    char* next;
+    char* comment;
 
-    if (*str)
-        tokv[tokc++] = str;
+    comment = strchr(line, '#');
+    if (comment)
+        *comment = '\0';
+
+    for (; line && !shell.exitFlag(); line = next)
+    {
+        next = strchr(line, ';');
+        if (next)
+            *next++ = '\0';
 
-    return tokc;
+        if (!invoke(shell, line))
+        {
+            failed = true;
+            if (!config.keepGoing)
+                return false;
+        }
+    }
+
+    return !shell.exitFlag();
 }
 
-int
-main(int argc, char* argv[])
+static bool
+runFile(Shell& shell, const char* filename, bool& failed)
+{
+    FILE* infile;
+    char line[1024];
+    bool result = true;
+
+    if (strcmp(filename, "-") == 0)
+        infile = stdin;
+    else
+        infile = fopen(filename, "r");
+    if (!infile)
+    {
+        perror(filename);
+        failed = true;
+        return false;
+    }
+
+    while (result && fgets(line, sizeof(line), infile))
+        result = runLine(shell, line, failed);
+
+    if (infile != stdin)
+        fclose(infile);
+
+    return result;
+}
+
+static void
+interactive(Shell& shell)
 {
     char *input;
     char *str;
-    char *tokv[5];
-    int tokc;
     char *expansion;
     int result;
 
@@ -70,34 +208,81 @@ main(int argc, char* argv[])
 
     using_history();
 
-    try
+    while (!shell.exitFlag())
     {
-        Shell shell;
+        input = readline("bossa> ");
+        if (!input)
+        {
+            printf("\n");
+            break;
+        }
+
+        for (str = input; *str && isspace(*str); str++);
 
-        while (!shell.exitFlag())
+        if (*str)
         {
-            input = readline("bossa> ");
-            if (!input)
+            result = history_expand(input, &expansion);
+            if (result >= 0 && result != 2)
             {
-                printf("\n");
-                break;
+                add_history(expansion);
+                invoke(shell, expansion);
             }
+            free(expansion);
+        }
+        free(input);
+    }
+}
 
-            for (str = input; *str && isspace(*str); str++);
+int
+main(int argc, char* argv[])
+{
+    int args;
+    char* pos;
+    bool failed = false;
+    CmdOpts cmd(argc, argv, sizeof(opts) / sizeof(opts[0]), opts);
 
-            if (*str)
-            {
-                result = history_expand(input, &expansion);
-                if (result >= 0 && result != 2)
-                {
-                    add_history(expansion);
-                    tokc = split(expansion, tokv, ARRAY_SIZE(tokv));
-                    shell.invoke(tokv, tokc);
-                }
-                free(expansion);
-            }
-            free(input);
+    if ((pos = strrchr(argv[0], '/')) || (pos = strrchr(argv[0], '\\')))
+        argv[0] = pos + 1;
+
+    args = cmd.parse();
+    if (args < 0 || args != argc)
+    {
+        fprintf(stderr, "Try '%s -h' or '%s --help' for more information\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    if (config.help)
+    {
+        printf("Usage: %s [OPTION...]\n", argv[0]);
+        printf("Basic Open Source SAM-BA Application (BOSSA) Shell\n"
+               "Version " VERSION "\n"
+               "\n"
+               "Without -f or -c, commands are read interactively.\n"
+               "\n");
+        cmd.usage(stdout);
+        return 0;
+    }
+
+    try
+    {
+        Shell shell;
+
+        if (!config.file && !config.command)
+        {
+            interactive(shell);
+            return 0;
+        }
+
+        // The connection stays open across all of the batch commands
+        if (config.command)
+        {
+            vector<char> line(config.commandArg.begin(), config.commandArg.end());
+            line.push_back('\0');
+            if (!runLine(shell, &line[0], failed))
+                return failed ? 1 : 0;
         }
+        if (config.file)
+            runFile(shell, config.fileArg.c_str(), failed);
     }
     catch(...)
     {
@@ -105,5 +290,5 @@ main(int argc, char* argv[])
         return 1;
     }
 
-    return 0;
+    return failed ? 1 : 0;
 }
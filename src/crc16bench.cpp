@@ -0,0 +1,84 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <vector>
+
+#include "Crc16.h"
+
+typedef uint16_t (*CrcKernel)(const uint8_t* data, int len, uint16_t crc);
+
+// Total bytes hashed per measurement
+#define BENCH_BYTES     (256 * 1024 * 1024)
+
+static double
+measure(CrcKernel kernel, const std::vector<uint8_t>& data, int len, uint16_t& crc)
+{
+    struct timeval start;
+    struct timeval end;
+    int rounds = BENCH_BYTES / len;
+    double secs;
+
+    crc = 0;
+    gettimeofday(&start, NULL);
+    for (int round = 0; round < rounds; round++)
+        crc = kernel(&data[(round * len) % (data.size() - len + 1)], len, crc);
+    gettimeofday(&end, NULL);
+
+    secs = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+    return (double) rounds * len / secs / 1e6;
+}
+
+int
+main(int argc, char* argv[])
+{
+    static const int lengths[] = { 128, 1024, 65536 };
+    std::vector<uint8_t> data(1024 * 1024);
+    uint16_t crcBytewise;
+    uint16_t crcSliced;
+    double mbBytewise;
+    double mbSliced;
+    int status = 0;
+
+    srand(1);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = rand();
+
+    printf("CRC-16/XMODEM throughput (MB/s)\n");
+    printf("%8s %10s %10s %8s\n", "Length", "Bytewise", "Slice-by-8", "Speedup");
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+    {
+        mbBytewise = measure(Crc16::xmodemBytewise, data, lengths[i], crcBytewise);
+        mbSliced = measure(Crc16::xmodem, data, lengths[i], crcSliced);
+        printf("%8d %10.1f %10.1f %7.2fx\n", lengths[i], mbBytewise, mbSliced,
+               mbSliced / mbBytewise);
+
+        // Both kernels chain the same blocks so their results must agree
+        if (crcBytewise != crcSliced)
+        {
+            fprintf(stderr, "CRC mismatch at length %d: %04x != %04x\n",
+                    lengths[i], crcBytewise, crcSliced);
+            status = 1;
+        }
+    }
+
+    return status;
+}
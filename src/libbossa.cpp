@@ -0,0 +1,216 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#include <string>
+#include <exception>
+#include <string.h>
+
+#include "libbossa.h"
+#include "Session.h"
+
+class ProgressObserver : public FlasherObserver
+{
+public:
+    ProgressObserver() : fn(NULL), context(NULL), cancelled(false) {}
+
+    void onStatus(const char* message, ...) {}
+    void onProgress(int num, int div)
+    {
+        if (fn && fn(context, num, div))
+            cancelled = true;
+    }
+    bool isCancelled() { return cancelled; }
+
+    bossa_progress_fn fn;
+    void* context;
+    bool cancelled;
+};
+
+struct bossa_session
+{
+    bossa_session() : session(&observer) {}
+
+    ProgressObserver observer;
+    Session session;
+    std::string error;
+};
+
+// Runs one session call and turns any exception into an error code
+#define BOSSA_CALL(session, call)                   \
+    do                                              \
+    {                                               \
+        (session)->observer.cancelled = false;      \
+        try                                         \
+        {                                           \
+            call;                                   \
+        }                                           \
+        catch (std::exception& e)                   \
+        {                                           \
+            (session)->error = e.what();            \
+            return BOSSA_ERROR;                     \
+        }                                           \
+        catch (...)                                 \
+        {                                           \
+            (session)->error = "Unhandled exception"; \
+            return BOSSA_ERROR;                     \
+        }                                           \
+    } while (0)
+
+#define BOSSA_CHECK_OPEN(session)                   \
+    do                                              \
+    {                                               \
+        if (!(session)->session.isOpen())           \
+        {                                           \
+            (session)->error = "Session is not open"; \
+            return BOSSA_NOT_OPEN;                  \
+        }                                           \
+    } while (0)
+
+const char*
+bossa_version(void)
+{
+    return VERSION;
+}
+
+bossa_session*
+bossa_new(void)
+{
+    try
+    {
+        return new bossa_session;
+    }
+    catch (...)
+    {
+        return NULL;
+    }
+}
+
+void
+bossa_free(bossa_session* session)
+{
+    try
+    {
+        delete session;
+    }
+    catch (...)
+    {
+    }
+}
+
+const char*
+bossa_error(bossa_session* session)
+{
+    return session->error.c_str();
+}
+
+void
+bossa_set_progress(bossa_session* session, bossa_progress_fn fn, void* context)
+{
+    session->observer.fn = fn;
+    session->observer.context = context;
+}
+
+int
+bossa_open(bossa_session* session, const char* port)
+{
+    BOSSA_CALL(session, session->session.open(port ? port : ""));
+    return BOSSA_OK;
+}
+
+int
+bossa_close(bossa_session* session)
+{
+    BOSSA_CALL(session, session->session.close());
+    return BOSSA_OK;
+}
+
+int
+bossa_identify(bossa_session* session, bossa_chip_info* info)
+{
+    bossa_chip_info full;
+    uint32_t size = info->struct_size;
+
+    BOSSA_CHECK_OPEN(session);
+    if (size < sizeof(info->struct_size))
+    {
+        session->error = "bossa_chip_info struct_size is not set";
+        return BOSSA_ERROR;
+    }
+
+    BOSSA_CALL(session,
+        const ChipInfo& chip = session->session.identify();
+
+        memset(&full, 0, sizeof(full));
+        full.chip_id = chip.chipId;
+        full.flash_size = session->session.flashSize();
+        full.page_size = session->session.pageSize();
+        full.is_usb = chip.isUsb;
+        strncpy(full.name, session->session.name().c_str(), sizeof(full.name) - 1);
+        strncpy(full.version, chip.version.c_str(), sizeof(full.version) - 1);
+    );
+
+    // A caller built against an older header only gets the fields it knows
+    if (size > sizeof(full))
+        size = sizeof(full);
+    full.struct_size = size;
+    memcpy(info, &full, size);
+    return BOSSA_OK;
+}
+
+int
+bossa_erase(bossa_session* session)
+{
+    BOSSA_CHECK_OPEN(session);
+    BOSSA_CALL(session, session->session.erase());
+    return BOSSA_OK;
+}
+
+int
+bossa_write(bossa_session* session, uint32_t offset, const uint8_t* data, uint32_t size)
+{
+    BOSSA_CHECK_OPEN(session);
+    BOSSA_CALL(session, session->session.write(offset, data, size));
+    return BOSSA_OK;
+}
+
+int
+bossa_verify(bossa_session* session, uint32_t offset, const uint8_t* data, uint32_t size,
+             uint32_t* byte_errors)
+{
+    uint32_t errors = 0;
+    bool match = false;
+
+    BOSSA_CHECK_OPEN(session);
+    BOSSA_CALL(session, match = session->session.verify(offset, data, size, errors));
+    if (byte_errors)
+        *byte_errors = errors;
+    if (!match)
+    {
+        session->error = "Verify failed";
+        return BOSSA_VERIFY_FAILED;
+    }
+    return BOSSA_OK;
+}
+
+int
+bossa_read(bossa_session* session, uint32_t offset, uint8_t* data, uint32_t size)
+{
+    BOSSA_CHECK_OPEN(session);
+    BOSSA_CALL(session, session->session.read(offset, data, size));
+    return BOSSA_OK;
+}
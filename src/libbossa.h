@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef _LIBBOSSA_H
+#define _LIBBOSSA_H
+
+// C interface to libbossa.  Every call taking a session returns BOSSA_OK
+// or an error code and leaves a description in bossa_error().  Callers set
+// struct_size of bossa_chip_info to the size they were built with and the
+// library fills no more than that, so the struct can grow at its end
+// without breaking them.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BOSSA_OK            0
+#define BOSSA_ERROR         -1
+#define BOSSA_NOT_OPEN      -2
+#define BOSSA_VERIFY_FAILED -3
+
+typedef struct bossa_session bossa_session;
+
+typedef struct bossa_chip_info
+{
+    uint32_t struct_size;   // Set to sizeof(bossa_chip_info) by the caller
+    uint32_t chip_id;
+    uint32_t flash_size;
+    uint32_t page_size;
+    int is_usb;
+    char name[32];
+    char version[128];
+} bossa_chip_info;
+
+// Called between batches of pages; returning non-zero cancels the operation
+typedef int (*bossa_progress_fn)(void* context, int num, int div);
+
+const char* bossa_version(void);
+
+bossa_session* bossa_new(void);
+void bossa_free(bossa_session* session);
+const char* bossa_error(bossa_session* session);
+void bossa_set_progress(bossa_session* session, bossa_progress_fn fn, void* context);
+
+int bossa_open(bossa_session* session, const char* port);
+int bossa_close(bossa_session* session);
+int bossa_identify(bossa_session* session, bossa_chip_info* info);
+
+int bossa_erase(bossa_session* session);
+int bossa_write(bossa_session* session, uint32_t offset, const uint8_t* data, uint32_t size);
+int bossa_verify(bossa_session* session, uint32_t offset, const uint8_t* data, uint32_t size,
+                 uint32_t* byte_errors);
+int bossa_read(bossa_session* session, uint32_t offset, uint8_t* data, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _LIBBOSSA_H
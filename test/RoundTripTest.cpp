@@ -0,0 +1,312 @@
+///////////////////////////////////////////////////////////////////////////////
+// BOSSA
+//
+// Copyright (C) 2011-2012 ShumaTech http://www.shumatech.com/
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+///////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "MemorySerialPort.h"
+#include "BenchSerialPort.h"
+#include "Samba.h"
+#include "Flash.h"
+#include "FlashFactory.h"
+#include "Flasher.h"
+#include "Session.h"
+
+// Pages moved by each measurement after the warm up
+#define TEST_PAGES      16
+
+#define CHIP_SAM3S4     0x28900960      // EEFC, one plane
+#define CHIP_SAM3U4     0x28000960      // EEFC, two planes
+#define CHIP_SAM7S512   0x270b0a40      // EFC, two planes
+#define CHIP_SAM4LS8    0x2b0b0ae0      // CALW
+
+// Upper bounds on the link traffic of one page.  Transfers are the calls
+// that reach the port.  Bytes are counted in both directions beyond the
+// page itself.  A change that adds a command or a round trip to one of
+// these paths has to raise its budget.
+class Budget
+{
+public:
+    double transfers;
+    double roundTrips;
+    double bytes;
+    double flushes;
+};
+
+static int failures = 0;
+
+// An emulated device with the link traffic to it counted
+class Target
+{
+public:
+    Target(uint32_t chipId, MemorySerialPort::Bug bug = MemorySerialPort::BUG_NONE);
+
+    MemorySerialPort* memory;
+    BenchSerialPort* port;
+    const Device* dev;
+    Samba samba;
+    Flash::Ptr flash;
+
+    void pattern(std::vector<uint8_t>& data, uint32_t pages);
+    void loadFlash(const std::vector<uint8_t>& data);
+
+private:
+    FlashFactory _flashFactory;
+};
+
+Target::Target(uint32_t chipId, MemorySerialPort::Bug bug)
+{
+    SerialPort::Ptr image;
+
+    dev = _flashFactory.device(chipId);
+    memory = new MemorySerialPort("test");
+    image.reset(memory);
+    memory->mapDevice(*dev);
+    memory->setBug(bug);
+
+    port = new BenchSerialPort(image);
+    SerialPort::Ptr ptr(port);
+
+    // Every USB monitor gets all the workarounds whichever bug it has
+    if (!samba.connect(ptr))
+        throw SambaError();
+    if (samba.info().quirks != (ChipInfo::QUIRK_READ_POW2 | ChipInfo::QUIRK_PACKET_MERGE))
+    {
+        printf("FAIL %08x: monitor quirks %#x\n", chipId, samba.info().quirks);
+        failures++;
+    }
+    flash = _flashFactory.create(samba, chipId);
+}
+
+void
+Target::pattern(std::vector<uint8_t>& data, uint32_t pages)
+{
+    data.resize(pages * dev->size);
+    for (uint32_t i = 0; i < data.size(); i++)
+        data[i] = i * 7 + (i >> 8) + 1;
+}
+
+void
+Target::loadFlash(const std::vector<uint8_t>& data)
+{
+    memory->writeMemory(dev->addr, &data[0], data.size());
+}
+
+static void
+expect(const char* test, const char* what, uint32_t total, double perPage, double budget)
+{
+    if (perPage <= budget)
+        return;
+
+    printf("FAIL %s: %.2f %s per page is over the budget of %.2f (%u in total)\n",
+           test, perPage, what, budget, total);
+    failures++;
+}
+
+static void
+check(const char* test, const Budget& budget, Target& target)
+{
+    const BenchCounters& counters = target.port->counters();
+    uint32_t bytes = counters.bytesOut + counters.bytesIn;
+
+    expect(test, "transfers", counters.syscalls,
+           (double) counters.syscalls / TEST_PAGES, budget.transfers);
+    expect(test, "round trips", counters.roundTrips,
+           (double) counters.roundTrips / TEST_PAGES, budget.roundTrips);
+    expect(test, "extra bytes", bytes,
+           (double) bytes / TEST_PAGES - target.dev->size, budget.bytes);
+    expect(test, "flushes", counters.flushes,
+           (double) counters.flushes / TEST_PAGES, budget.flushes);
+
+    printf("%-24s %6.2f transfers %5.2f round trips %7.2f extra bytes %5.2f flushes per page\n",
+           test, (double) counters.syscalls / TEST_PAGES,
+           (double) counters.roundTrips / TEST_PAGES,
+           (double) bytes / TEST_PAGES - target.dev->size,
+           (double) counters.flushes / TEST_PAGES);
+}
+
+static void
+testWritePage(const char* test, uint32_t chipId, const Budget& budget,
+              MemorySerialPort::Bug bug = MemorySerialPort::BUG_NONE)
+{
+    Target target(chipId, bug);
+    uint32_t first = target.dev->reserved / target.dev->size;
+    std::vector<uint8_t> data;
+
+    target.pattern(data, TEST_PAGES);
+
+    // The first pages upload the applet and settle its parameters
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        target.flash->loadBuffer(&data[0]);
+        target.flash->writePage(first + i);
+    }
+    target.port->reset();
+    for (uint32_t i = 0; i < TEST_PAGES; i++)
+    {
+        target.flash->loadBuffer(&data[i * target.dev->size]);
+        target.flash->writePage(first + 2 + i);
+    }
+    check(test, budget, target);
+}
+
+static void
+testWritePages(const char* test, uint32_t chipId, const Budget& budget)
+{
+    Target target(chipId);
+    uint32_t first = target.dev->reserved / target.dev->size;
+    std::vector<uint8_t> data;
+
+    target.pattern(data, TEST_PAGES);
+
+    target.flash->writePages(first, &data[0], 2);
+    target.port->reset();
+    target.flash->writePages(first + 2, &data[0], TEST_PAGES);
+    check(test, budget, target);
+}
+
+static void
+testSend(const char* test, uint32_t chipId, const Budget& budget)
+{
+    Target target(chipId, MemorySerialPort::BUG_SEND_MERGE);
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> page(target.dev->size);
+
+    // Each S command must reach the monitor in a USB packet of its own
+    // or its data is lost
+    target.pattern(data, TEST_PAGES);
+    target.port->reset();
+    for (uint32_t i = 0; i < TEST_PAGES; i++)
+        target.samba.write(target.dev->user, &data[i * target.dev->size], page.size());
+    check(test, budget, target);
+
+    target.samba.read(target.dev->user, &page[0], page.size());
+    if (memcmp(&page[0], &data[(TEST_PAGES - 1) * target.dev->size], page.size()) != 0)
+    {
+        printf("FAIL %s: sent data was lost\n", test);
+        failures++;
+    }
+}
+
+static void
+testReadPage(const char* test, uint32_t chipId, const Budget& budget, bool direct)
+{
+    Target target(chipId);
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> page(target.dev->size);
+
+    // Flash that reads as zero cannot prove direct reads work so pages
+    // are copied through SRAM instead
+    target.pattern(data, TEST_PAGES);
+    if (!direct)
+        memset(&data[0], 0, data.size());
+    target.loadFlash(data);
+
+    target.flash->readPage(0, &page[0]);
+    target.port->reset();
+    for (uint32_t i = 0; i < TEST_PAGES; i++)
+    {
+        target.flash->readPage(i, &page[0]);
+        if (memcmp(&page[0], &data[i * target.dev->size], page.size()) != 0 && direct)
+        {
+            printf("FAIL %s: page %u read back wrong\n", test, i);
+            failures++;
+        }
+    }
+    check(test, budget, target);
+}
+
+static void
+testVerify(const char* test, uint32_t chipId, const Budget& budget)
+{
+    Target target(chipId);
+    Session::QuietObserver observer;
+    Flasher flasher(target.flash, observer);
+    std::vector<uint8_t> data;
+    uint32_t pageErrors;
+    uint32_t totalErrors;
+
+    target.pattern(data, TEST_PAGES);
+    target.loadFlash(data);
+
+    flasher.verify(&data[0], data.size(), 0, pageErrors, totalErrors);
+    target.port->reset();
+    if (!flasher.verify(&data[0], data.size(), 0, pageErrors, totalErrors))
+    {
+        printf("FAIL %s: %u byte errors\n", test, totalErrors);
+        failures++;
+    }
+    check(test, budget, target);
+}
+
+int
+main(int argc, char* argv[])
+{
+    // Transfers, round trips, extra bytes and flushes per page.  Each page
+    // written alone costs one status poll and a second plane adds one
+    // status word to it.  USB monitors get every workaround, so each S
+    // and G command is flushed and power of two reads split off a byte.
+    static const Budget eefcWrite = { 11, 1, 91, 3 };
+    static const Budget eefc2Write = { 13, 2, 107, 3 };
+    static const Budget eefcMergeWrite = { 11, 1, 91, 3 };
+    static const Budget efcWrite = { 11, 1, 114, 3 };
+    static const Budget calwWrite = { 10, 1, 84, 3 };
+    static const Budget eefcWrites = { 8.2, 1, 74, 2.1 };
+    static const Budget efcWrites = { 8.2, 1, 97, 2.1 };
+    static const Budget calwWrites = { 1.25, 0.13, 11, 0.38 };
+    static const Budget eefcRead = { 6, 3, 47, 0 };
+    static const Budget eefcCopyRead = { 10.9, 3, 79, 2 };
+    static const Budget efcRead = { 6, 3, 70, 0 };
+    static const Budget calwRead = { 6, 3, 47, 0 };
+    static const Budget eefcVerify = { 0.38, 0.19, 3, 0 };
+    static const Budget efcVerify = { 0.38, 0.19, 4.4, 0 };
+    static const Budget calwVerify = { 0.5, 0.25, 4.4, 0 };
+    static const Budget sambaSend = { 3, 0, 19, 1 };
+
+    try
+    {
+        testWritePage("EefcFlash::writePage", CHIP_SAM3S4, eefcWrite);
+        testWritePage("EefcFlash::writePage 2P", CHIP_SAM3U4, eefc2Write);
+        testWritePage("EefcFlash::writePage PM", CHIP_SAM3S4, eefcMergeWrite,
+                      MemorySerialPort::BUG_PACKET_MERGE);
+        testWritePage("EefcFlash::writePage SM", CHIP_SAM3S4, eefcMergeWrite,
+                      MemorySerialPort::BUG_SEND_MERGE);
+        testSend("Samba::write SM", CHIP_SAM3S4, sambaSend);
+        testWritePage("EfcFlash::writePage", CHIP_SAM7S512, efcWrite);
+        testWritePage("FlashCalW::writePage", CHIP_SAM4LS8, calwWrite);
+        testWritePages("EefcFlash::writePages", CHIP_SAM3S4, eefcWrites);
+        testWritePages("EfcFlash::writePages", CHIP_SAM7S512, efcWrites);
+        testWritePages("FlashCalW::writePages", CHIP_SAM4LS8, calwWrites);
+        testReadPage("EefcFlash::readPage", CHIP_SAM3S4, eefcRead, true);
+        testReadPage("EefcFlash::readPage copy", CHIP_SAM3S4, eefcCopyRead, false);
+        testReadPage("EfcFlash::readPage", CHIP_SAM7S512, efcRead, true);
+        testReadPage("FlashCalW::readPage", CHIP_SAM4LS8, calwRead, true);
+        testVerify("Flasher::verify", CHIP_SAM3S4, eefcVerify);
+        testVerify("Flasher::verify EFC", CHIP_SAM7S512, efcVerify);
+        testVerify("Flasher::verify CALW", CHIP_SAM4LS8, calwVerify);
+    }
+    catch (std::exception& e)
+    {
+        printf("FAIL %s\n", e.what());
+        failures++;
+    }
+
+    printf("%s: %d failures\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}